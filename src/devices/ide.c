@@ -34,6 +34,7 @@
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -49,6 +50,16 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+
+/* Most sectors transferred by one command.  The sector count
+   register holds up to 256, as 0, but we stay clear of that. */
+#define MAX_CMD_SECTORS 128
+
+/* Largest DRQ block we ask a disk to use, in sectors. */
+#define MAX_MULTIPLE 16
 
 /* An ATA device. */
 struct ata_disk
@@ -57,6 +68,8 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+    int multiple;               /* Sectors per interrupt; 1 unless
+                                   READ/WRITE MULTIPLE is in use. */
   };
 
 /* An ATA channel (aka controller).
@@ -71,6 +84,8 @@ struct channel
     bool expecting_interrupt;   /* True if an interrupt is expected, false if
                                    any interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
+    struct timer completion_timer;      /* Gives up on a lost interrupt. */
+    bool timed_out;             /* True if completion_timer fired. */
 
     struct ata_disk devices[2];     /* The devices on this channel. */
   };
@@ -85,10 +100,14 @@ static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
 
-static void select_sector (struct ata_disk *, block_sector_t);
+static void set_multiple_mode (struct ata_disk *, const char *id);
+static void select_sectors (struct ata_disk *, block_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
-static void input_sector (struct channel *, void *);
-static void output_sector (struct channel *, const void *);
+static void expect_interrupt (struct channel *);
+static bool wait_for_completion (struct channel *);
+static void completion_timeout (void *);
+static void input_sectors (struct channel *, void *, size_t cnt);
+static void output_sectors (struct channel *, const void *, size_t cnt);
 
 static void wait_until_idle (const struct ata_disk *);
 static bool wait_while_busy (const struct ata_disk *);
@@ -124,7 +143,9 @@ ide_init (void)
           NOT_REACHED ();
         }
       lock_init (&c->lock);
+      lock_set_name (&c->lock, c->name);
       c->expecting_interrupt = false;
+      c->timed_out = false;
       sema_init (&c->completion_wait, 0);
  
       /* Initialize devices. */
@@ -136,6 +157,7 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          d->multiple = 1;
         }
 
       /* Register interrupt handler. */
@@ -273,13 +295,12 @@ identify_ata_device (struct ata_disk *d)
      into our buffer. */
   select_device_wait (d);
   issue_pio_command (c, CMD_IDENTIFY_DEVICE);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
+  if (!wait_for_completion (c) || !wait_while_busy (d))
     {
       d->is_ata = false;
       return;
     }
-  input_sector (c, id);
+  input_sectors (c, id, 1);
 
   /* Calculate capacity.
      Read model name and serial number. */
@@ -303,6 +324,8 @@ identify_ata_device (struct ata_disk *d)
       return;
     }
 
+  set_multiple_mode (d, id);
+
   /* Register. */
   block = block_register (d->name, BLOCK_RAW, extra_info, capacity,
                           &ide_operations, d);
@@ -337,63 +360,160 @@ descramble_ata_string (char *string, int size)
   return string;
 }
 
-/* Reads sector SEC_NO from disk D into BUFFER, which must have
-   room for BLOCK_SECTOR_SIZE bytes.
+/* Switches disk D, whose IDENTIFY DEVICE data is ID, to
+   transferring several sectors per interrupt with READ MULTIPLE
+   and WRITE MULTIPLE, if it supports that.  Otherwise, D
+   interrupts once per sector. */
+static void
+set_multiple_mode (struct ata_disk *d, const char *id) 
+{
+  struct channel *c = d->channel;
+  int max = *(uint16_t *) &id[47 * 2] & 0xff;
+  int multiple;
+
+  d->multiple = 1;
+  for (multiple = MAX_MULTIPLE; multiple > max; multiple /= 2)
+    continue;
+  if (multiple < 2)
+    return;
+
+  select_device_wait (d);
+  outb (reg_nsect (c), multiple);
+  issue_pio_command (c, CMD_SET_MULTIPLE_MODE);
+  if (wait_for_completion (c))
+    {
+      wait_while_busy (d);
+      if ((inb (reg_alt_status (c)) & STA_ERR) == 0)
+        d->multiple = multiple;
+    }
+}
+
+/* Reads CNT sectors starting at SEC_NO from disk D into BUFFER,
+   which must have room for CNT * BLOCK_SECTOR_SIZE bytes.  Each
+   command transfers up to MAX_CMD_SECTORS sectors, interrupting
+   once per D->multiple of them.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_read (void *d_, block_sector_t sec_no, void *buffer)
+ide_read_multiple (void *d_, block_sector_t sec_no, size_t cnt, void *buffer)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
+  uint8_t *p = buffer;
+
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
+  while (cnt > 0) 
+    {
+      size_t cmd_cnt = cnt < MAX_CMD_SECTORS ? cnt : MAX_CMD_SECTORS;
+      size_t left;
+
+      select_sectors (d, sec_no, cmd_cnt);
+      issue_pio_command (c, (d->multiple > 1
+                             ? CMD_READ_MULTIPLE : CMD_READ_SECTOR_RETRY));
+      for (left = cmd_cnt; left > 0; ) 
+        {
+          size_t n = left < (size_t) d->multiple ? left : (size_t) d->multiple;
+          if (!wait_for_completion (c) || !wait_while_busy (d))
+            PANIC ("%s: disk read failed, sector=%"PRDSNu,
+                   d->name, sec_no + (cmd_cnt - left));
+          if (left > n)
+            expect_interrupt (c);       /* For the next block. */
+          input_sectors (c, p, n);
+          p += n * BLOCK_SECTOR_SIZE;
+          left -= n;
+        }
+      sec_no += cmd_cnt;
+      cnt -= cmd_cnt;
+    }
   lock_release (&c->lock);
 }
 
-/* Write sector SEC_NO to disk D from BUFFER, which must contain
-   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
-   acknowledged receiving the data.
+/* Writes CNT sectors starting at SEC_NO to disk D from BUFFER,
+   which must contain CNT * BLOCK_SECTOR_SIZE bytes.  Returns
+   after the disk has acknowledged receiving the data.  Each
+   command transfers up to MAX_CMD_SECTORS sectors, interrupting
+   once per D->multiple of them.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_write (void *d_, block_sector_t sec_no, const void *buffer)
+ide_write_multiple (void *d_, block_sector_t sec_no, size_t cnt,
+                    const void *buffer)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
+  const uint8_t *p = buffer;
+
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
+  while (cnt > 0) 
+    {
+      size_t cmd_cnt = cnt < MAX_CMD_SECTORS ? cnt : MAX_CMD_SECTORS;
+      size_t left;
+
+      select_sectors (d, sec_no, cmd_cnt);
+      issue_pio_command (c, (d->multiple > 1
+                             ? CMD_WRITE_MULTIPLE : CMD_WRITE_SECTOR_RETRY));
+
+      /* The disk asks for the first block by setting DRQ, and
+         for each later one, and finally reports completion, by
+         interrupting. */
+      for (left = cmd_cnt; left > 0; ) 
+        {
+          size_t n = left < (size_t) d->multiple ? left : (size_t) d->multiple;
+          if ((left != cmd_cnt && !wait_for_completion (c))
+              || !wait_while_busy (d))
+            PANIC ("%s: disk write failed, sector=%"PRDSNu,
+                   d->name, sec_no + (cmd_cnt - left));
+          expect_interrupt (c);
+          output_sectors (c, p, n);
+          p += n * BLOCK_SECTOR_SIZE;
+          left -= n;
+        }
+      if (!wait_for_completion (c))
+        PANIC ("%s: disk write timed out, sector=%"PRDSNu, d->name, sec_no);
+      sec_no += cmd_cnt;
+      cnt -= cmd_cnt;
+    }
   lock_release (&c->lock);
 }
 
+/* Reads sector SEC_NO from disk D into BUFFER, which must have
+   room for BLOCK_SECTOR_SIZE bytes. */
+static void
+ide_read (void *d, block_sector_t sec_no, void *buffer)
+{
+  ide_read_multiple (d, sec_no, 1, buffer);
+}
+
+/* Write sector SEC_NO to disk D from BUFFER, which must contain
+   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
+   acknowledged receiving the data. */
+static void
+ide_write (void *d, block_sector_t sec_no, const void *buffer)
+{
+  ide_write_multiple (d, sec_no, 1, buffer);
+}
+
 static struct block_operations ide_operations =
   {
     ide_read,
-    ide_write
+    ide_write,
+    ide_read_multiple,
+    ide_write_multiple
   };
-
+
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes the first sector SEC_NO and the sector count CNT to
+   the disk's sector selection registers.  (We use LBA mode.) */
 static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+select_sectors (struct ata_disk *d, block_sector_t sec_no, size_t cnt)
 {
   struct channel *c = d->channel;
 
   ASSERT (sec_no < (1UL << 28));
+  ASSERT (cnt > 0 && cnt <= MAX_CMD_SECTORS);
   
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt);
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -410,24 +530,68 @@ issue_pio_command (struct channel *c, uint8_t command)
      up'd by the completion handler. */
   ASSERT (intr_get_level () == INTR_ON);
 
-  c->expecting_interrupt = true;
+  expect_interrupt (c);
   outb (reg_command (c), command);
 }
 
-/* Reads a sector from channel C's data register in PIO mode into
-   SECTOR, which must have room for BLOCK_SECTOR_SIZE bytes. */
+/* Prepares channel C for receiving one completion interrupt,
+   which must be waited for with wait_for_completion(). */
+static void
+expect_interrupt (struct channel *c) 
+{
+  enum intr_level old_level = intr_disable ();
+  c->expecting_interrupt = true;
+  c->timed_out = false;
+  intr_set_level (old_level);
+}
+
+/* Waits for the completion interrupt that channel C was last
+   prepared for.  Returns true if it arrived, false if it did not
+   arrive within 30 seconds, in which case the interrupt is
+   ignored if it turns up later. */
+static bool
+wait_for_completion (struct channel *c) 
+{
+  timer_add (&c->completion_timer, completion_timeout, c,
+             timer_ticks () + 30 * TIMER_FREQ);
+  sema_down (&c->completion_wait);
+  timer_cancel (&c->completion_timer);
+  return !c->timed_out;
+}
+
+/* Timer callback that wakes up the waiter in
+   wait_for_completion() when the disk never interrupts.  Does
+   nothing if the interrupt won the race. */
+static void
+completion_timeout (void *c_) 
+{
+  struct channel *c = c_;
+
+  if (c->expecting_interrupt) 
+    {
+      printf ("%s: interrupt timeout\n", c->name);
+      c->expecting_interrupt = false;
+      c->timed_out = true;
+      sema_up (&c->completion_wait);
+    }
+}
+
+/* Reads CNT sectors from channel C's data register in PIO mode
+   into SECTORS, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes. */
 static void
-input_sector (struct channel *c, void *sector) 
+input_sectors (struct channel *c, void *sectors, size_t cnt) 
 {
-  insw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
+  insw (reg_data (c), sectors, cnt * BLOCK_SECTOR_SIZE / 2);
 }
 
-/* Writes SECTOR to channel C's data register in PIO mode.
-   SECTOR must contain BLOCK_SECTOR_SIZE bytes. */
+/* Writes CNT sectors from SECTORS to channel C's data register in
+   PIO mode.  SECTORS must contain CNT * BLOCK_SECTOR_SIZE
+   bytes. */
 static void
-output_sector (struct channel *c, const void *sector) 
+output_sectors (struct channel *c, const void *sectors, size_t cnt) 
 {
-  outsw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
+  outsw (reg_data (c), sectors, cnt * BLOCK_SECTOR_SIZE / 2);
 }
 
 /* Low-level ATA primitives. */
@@ -511,9 +675,10 @@ interrupt_handler (struct intr_frame *f)
   for (c = channels; c < channels + CHANNEL_CNT; c++)
     if (f->vec_no == c->irq)
       {
+        inb (reg_status (c));                   /* Acknowledge interrupt. */
         if (c->expecting_interrupt) 
           {
-            inb (reg_status (c));               /* Acknowledge interrupt. */
+            c->expecting_interrupt = false;
             sema_up (&c->completion_wait);      /* Wake up waiter. */
           }
         else
@@ -11,9 +11,6 @@
 #define PIT_PORT_CONTROL          0x43                /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
 
@@ -81,3 +78,56 @@ pit_configure_channel (int channel, int mode, int frequency)
   outb (PIT_PORT_COUNTER (channel), count >> 8);
   intr_set_level (old_level);
 }
+
+/* Starts CHANNEL counting down COUNT PIT cycles in mode 0
+   ("interrupt on terminal count"): the channel's output goes
+   high once, after COUNT cycles, and stays high until the
+   channel is reprogrammed.  COUNT must be between 1 and 65536.
+
+   Channel 0 stays in this mode until pit_configure_channel() is
+   called again, so whoever starts a one-shot on it must restore
+   the periodic timer from the resulting interrupt. */
+void
+pit_start_oneshot (int channel, unsigned count)
+{
+  enum intr_level old_level;
+
+  ASSERT (channel == 0 || channel == 2);
+  ASSERT (count >= 1 && count <= 65536);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, (channel << 6) | 0x30 | (0 << 1));
+  outb (PIT_PORT_COUNTER (channel), count);
+  outb (PIT_PORT_COUNTER (channel), count >> 8);
+  intr_set_level (old_level);
+}
+
+/* Returns the number of PIT cycles left in CHANNEL's current
+   count, between 1 and 65536.  If OUTPUT is nonnull, stores the
+   state of the channel's output pin into *OUTPUT; in mode 0
+   it is true once the count has run out, after which the
+   returned count is meaningless.
+
+   Uses the 8254 read-back command, which latches the status and
+   the count together.  See [8254] "Read-Back Command". */
+unsigned
+pit_read_count (int channel, bool *output)
+{
+  enum intr_level old_level;
+  uint8_t status, lo, hi;
+  unsigned count;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, 0xc0 | (1 << (channel + 1)));
+  status = inb (PIT_PORT_COUNTER (channel));
+  lo = inb (PIT_PORT_COUNTER (channel));
+  hi = inb (PIT_PORT_COUNTER (channel));
+  intr_set_level (old_level);
+
+  if (output != NULL)
+    *output = (status & 0x80) != 0;
+  count = lo | (hi << 8);
+  return count != 0 ? count : 65536;
+}
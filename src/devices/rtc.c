@@ -1,5 +1,7 @@
 #include "devices/rtc.h"
+#include <debug.h>
 #include <stdio.h>
+#include "threads/interrupt.h"
 #include "threads/io.h"
 
 /* This code is an interface to the MC146818A-compatible real
@@ -28,14 +30,25 @@
 
 /* Register A. */
 #define RTCSA_UIP	0x80	/* Set while time update in progress. */
+#define RTCSA_RS	0x0f	/* Periodic interrupt rate select. */
 
 /* Register B. */
 #define	RTCSB_SET	0x80	/* Disables update to let time be set. */
+#define RTCSB_PIE	0x40	/* Periodic interrupt enable. */
 #define RTCSB_DM	0x04	/* 0 = BCD time format, 1 = binary format. */
 #define RTCSB_24HR	0x02    /* 0 = 12-hour format, 1 = 24-hour format. */
 
+/* Periodic interrupt rates, in Hz. */
+#define RTC_BASE_HZ 32768       /* Rate select 1 would give this... */
+#define RTC_MIN_RS 3            /* ...but rate selects 1 and 2 do not work. */
+#define RTC_MAX_RS 15
+
+static intr_handler_func *periodic_handler;
+
 static int bcd_to_bin (uint8_t);
 static uint8_t cmos_read (uint8_t index);
+static void cmos_write (uint8_t index, uint8_t data);
+static intr_handler_func rtc_interrupt;
 
 /* Returns number of seconds since Unix epoch of January 1,
    1970. */
@@ -95,6 +108,50 @@ rtc_get_time (void)
   return time;
 }
 
+/* Starts calling HANDLER from a periodic interrupt, at the lowest
+   rate the clock supports that is at least HZ, or at its highest
+   rate of 8192 Hz if HZ is more than that.  The supported rates
+   are the powers of 2 from 2 Hz up.  Returns the rate chosen.
+   Unlike the PIT, the rate does not have to divide evenly into
+   anything else, which makes this a good source of interrupts
+   for sampling. */
+int
+rtc_start_periodic (int hz, intr_handler_func *handler)
+{
+  enum intr_level old_level;
+  int rs;
+
+  ASSERT (hz > 0);
+  ASSERT (handler != NULL);
+  ASSERT (periodic_handler == NULL);
+
+  /* Rate select RS gives RTC_BASE_HZ >> (RS - 1) Hz. */
+  for (rs = RTC_MAX_RS; rs > RTC_MIN_RS; rs--)
+    if ((RTC_BASE_HZ >> (rs - 1)) >= hz)
+      break;
+
+  periodic_handler = handler;
+  intr_register_ext (0x28, rtc_interrupt, "MC146818A RTC");
+
+  old_level = intr_disable ();
+  cmos_write (RTC_REG_A, (cmos_read (RTC_REG_A) & ~RTCSA_RS) | rs);
+  cmos_write (RTC_REG_B, cmos_read (RTC_REG_B) | RTCSB_PIE);
+  cmos_read (RTC_REG_C);
+  intr_set_level (old_level);
+
+  return RTC_BASE_HZ >> (rs - 1);
+}
+
+/* Real-time clock interrupt handler. */
+static void
+rtc_interrupt (struct intr_frame *f)
+{
+  /* Reading register C acknowledges the interrupt, without which
+     the clock would not interrupt again. */
+  cmos_read (RTC_REG_C);
+  periodic_handler (f);
+}
+
 /* Returns the integer value of the given BCD byte. */
 static int
 bcd_to_bin (uint8_t x)
@@ -110,3 +167,11 @@ cmos_read (uint8_t index)
   outb (CMOS_REG_SET, index);
   return inb (CMOS_REG_IO);
 }
+
+/* Writes DATA to the CMOS register with the given INDEX. */
+static void
+cmos_write (uint8_t index, uint8_t data)
+{
+  outb (CMOS_REG_SET, index);
+  outb (CMOS_REG_IO, data);
+}
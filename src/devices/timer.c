@@ -17,24 +17,96 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
-/* Number of timer ticks since OS booted. */
+/* Number of timer ticks since OS booted.  Written only with
+   interrupts off, so readers can use ticks_seqlock instead of
+   disabling interrupts. */
 static int64_t ticks;
+static struct seqlock ticks_seqlock;
+
+/* Timer wheel.  A pending timer sits in slot DEADLINE %
+   TIMER_WHEEL_SLOTS, so arming and cancelling are constant time
+   and each tick only looks at the timers that hash to it.  Timers
+   whose deadline is more than one revolution away are skipped
+   until their round comes up. */
+#define TIMER_WHEEL_SLOTS 256
+static struct list timer_wheel[TIMER_WHEEL_SLOTS];
+
+/* Last tick whose wheel slot has been run. */
+static int64_t wheel_ticks;
+
+/* Tickless idle.
+
+   While the idle thread halts, timer_idle_enter() switches the
+   PIT to one-shot mode so that it interrupts at the next tick at
+   which something can happen (a timer deadline, or once a second
+   an mlfqs update), rather than at every tick.  INTERRUPT_TICKS
+   is the number of ticks that the next timer interrupt completes;
+   it is 1 in periodic mode.  The one-shot always ends exactly on
+   a tick boundary, so ticks stays in phase with real time.  The
+   16-bit PIT counter limits one interrupt to about 55 ms. */
+#define PIT_COUNTS_PER_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+#define PIT_MAX_COUNT 65536
+static int64_t interrupt_ticks = 1;
+static bool pit_oneshot;        /* PIT in one-shot mode? */
 
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* High-resolution clock.  timer_now_ns() scales the CPU's time
+   stamp counter, which counts cycles at a constant rate, by
+   tsc_mult / 2**tsc_shift nanoseconds per cycle.  Both are set by
+   timer_calibrate(), which measures the TSC against the PIT;
+   until then tsc_mult is 0 and the clock has tick resolution. */
+#define NSEC_PER_SEC 1000000000LL
+#define TSC_CALIBRATE_TICKS 5   /* Timer ticks to calibrate over. */
+static uint32_t tsc_mult;
+static unsigned tsc_shift;
+
+/* High-resolution sleeps.  A sleep shorter than a timer tick
+   blocks on hr_sleepers, ordered by deadline, and the PIT is
+   reprogrammed to interrupt early, at the first deadline, then
+   again at the end of the tick ("hr_rest" PIT cycles later).
+   INTERRUPT_TICKS is 0 while such an early interrupt is pending.
+   Sleeps shorter than TIMER_SPIN_NS, which is about what
+   blocking and waking up again costs, spin on the clock
+   instead. */
+#define TIMER_SPIN_NS 20000
+#define HR_SLACK_NS 1000        /* Wake sleepers this close to due. */
+struct hr_sleeper
+  {
+    struct list_elem elem;      /* Element in hr_sleepers. */
+    uint64_t deadline;          /* timer_now_ns() to wake up at. */
+    struct thread *thread;      /* Sleeping thread. */
+  };
+static struct list hr_sleepers;
+static unsigned hr_rest;
+
 static intr_handler_func timer_interrupt;
+static void advance_ticks (int64_t);
+static void timer_run_wheel (void);
+static int64_t timer_wheel_next (int64_t after, int64_t limit);
+static void wake_thread (void *t);
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static void hr_sleep (int64_t ns);
+static void hr_run (void);
+static void hr_arm (void);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void
 timer_init (void) 
 {
+  size_t i;
+
+  seqlock_init (&ticks_seqlock);
+  for (i = 0; i < TIMER_WHEEL_SLOTS; i++)
+    list_init (&timer_wheel[i]);
+  list_init (&hr_sleepers);
+
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -44,6 +116,8 @@ void
 timer_calibrate (void) 
 {
   unsigned high_bit, test_bit;
+  uint64_t tsc_start, tsc_hz;
+  int64_t start;
 
   ASSERT (intr_get_level () == INTR_ON);
   printf ("Calibrating timer...  ");
@@ -63,19 +137,66 @@ timer_calibrate (void)
     if (!too_many_loops (loops_per_tick | test_bit))
       loops_per_tick |= test_bit;
 
-  printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+  /* Count TSC cycles over a few whole timer ticks.  Choose the
+     largest shift for which the multiplier fits in 32 bits. */
+  start = ticks;
+  while (ticks == start)
+    barrier ();
+  tsc_start = timer_rdtsc ();
+  start = ticks;
+  while (ticks - start < TSC_CALIBRATE_TICKS)
+    barrier ();
+  tsc_hz = (timer_rdtsc () - tsc_start) * TIMER_FREQ / TSC_CALIBRATE_TICKS;
+  ASSERT (tsc_hz > 0);
+  for (tsc_shift = 32; ; tsc_shift--)
+    {
+      uint64_t mult = ((uint64_t) NSEC_PER_SEC << tsc_shift) / tsc_hz;
+      if (mult <= UINT32_MAX)
+        {
+          tsc_mult = mult;
+          break;
+        }
+    }
+
+  printf ("%'"PRIu64" loops/s, %'"PRIu64" TSC cycles/s.\n",
+          (uint64_t) loops_per_tick * TIMER_FREQ, tsc_hz);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
 int64_t
 timer_ticks (void) 
 {
-  enum intr_level old_level = intr_disable ();
-  int64_t t = ticks;
-  intr_set_level (old_level);
+  unsigned seq;
+  int64_t t;
+
+  do 
+    {
+      seq = seqlock_read_begin (&ticks_seqlock);
+      t = ticks;
+    }
+  while (seqlock_read_retry (&ticks_seqlock, seq));
   return t;
 }
 
+/* Returns the number of nanoseconds since the TSC was reset,
+   which is at about the time the machine booted.  Once
+   timer_calibrate() has run, the result never decreases;
+   before that, it is derived from the tick count instead. */
+uint64_t
+timer_now_ns (void) 
+{
+  uint64_t tsc;
+
+  if (tsc_mult == 0)
+    return timer_ticks () * (NSEC_PER_SEC / TIMER_FREQ);
+
+  /* Multiply the 64-bit TSC by the 32-bit multiplier in two
+     halves, so that no intermediate result overflows. */
+  tsc = timer_rdtsc ();
+  return (((tsc >> 32) * tsc_mult) << (32 - tsc_shift))
+         + (((tsc & UINT32_MAX) * tsc_mult) >> tsc_shift);
+}
+
 /* Returns the number of timer ticks elapsed since THEN, which
    should be a value once returned by timer_ticks(). */
 int64_t
@@ -90,35 +211,73 @@ void
 timer_sleep (int64_t ticks) 
 {
   int64_t start = timer_ticks ();
-  struct thread *cur = thread_current(); //현재 thread저장. running_thread에 sanity check 더한 것이 thread_current 사용할 것.
-  enum intr_level prev_level;
-  //sleep만드는 과정에서 인터럽트 일어나지 않도록 설정
-  prev_level = intr_disable ();
+  struct timer timer;
+  enum intr_level old_level;
 
-  //idle thread인지을 체크하기 위하여 thread.c에 thread_check_idle함수 추가
-  ASSERT(thread_check_idle() == 0);
+  ASSERT (intr_get_level () == INTR_ON);
+  ASSERT (!thread_check_idle ());
+  if (ticks <= 0)
+    return;
+
+  /* Interrupts must stay off from arming the timer until we
+     block, or the wakeup could be lost. */
+  old_level = intr_disable ();
+  timer_add (&timer, wake_thread, thread_current (), start + ticks);
+  thread_block ();
+  intr_set_level (old_level);
+}
 
-  //thread의 wakeup_tick에 ticks를 저장한다.
-  cur -> wakeup_tick = start + ticks;
+/* Timer callback that wakes the thread sleeping in timer_sleep(). */
+static void
+wake_thread (void *t) 
+{
+  thread_unblock (t);
+}
 
-  //list_sleep_thread에 삽입 (ticks에 대하여 오름차순 유지)
-  insert_sleep_thread();
-  
-  //status를 blocked로 변경한 뒤 스케쥴링 동작
-  thread_block();
-  
-  //기존 interupt 상태로 되돌림
-  intr_set_level(prev_level);
+/* Arms timer T to call FUNC with AUX as argument at tick
+   DEADLINE.  If DEADLINE has already passed, FUNC is called at
+   the next tick.  T must not already be pending, but need not be
+   initialized.  May be called from an interrupt handler. */
+void
+timer_add (struct timer *t, timer_func *func, void *aux, int64_t deadline) 
+{
+  enum intr_level old_level;
+  int64_t slot;
+
+  ASSERT (t != NULL);
+  ASSERT (func != NULL);
+
+  old_level = intr_disable ();
+  t->deadline = deadline;
+  t->func = func;
+  t->aux = aux;
+  t->pending = true;
+  slot = deadline > wheel_ticks ? deadline : wheel_ticks + 1;
+  list_push_back (&timer_wheel[slot % TIMER_WHEEL_SLOTS], &t->elem);
+  intr_set_level (old_level);
+}
 
+/* Disarms timer T, which must have been armed by timer_add().
+   Returns true if T was still pending, false if it had already
+   fired.  May be called from an interrupt handler. */
+bool
+timer_cancel (struct timer *t) 
+{
+  enum intr_level old_level;
+  bool was_pending;
 
-  //기존 구현
-  /*
-  int64_t start = timer_ticks ();
+  ASSERT (t != NULL);
 
-  ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks) 
-    thread_yield ();
-  */
+  old_level = intr_disable ();
+  was_pending = t->pending;
+  if (was_pending)
+    {
+      list_remove (&t->elem);
+      t->pending = false;
+    }
+  intr_set_level (old_level);
+
+  return was_pending;
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -191,11 +350,106 @@ timer_print_stats (void)
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
 }
 
+/* Called by the idle thread, with interrupts off, just before it
+   halts.  Postpones the next timer interrupt for as many ticks as
+   nothing is due. */
+void
+timer_idle_enter (void) 
+{
+  int64_t next, limit, deadline;
+  unsigned count;
+  bool expired;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* The next interrupt arrives COUNT PIT cycles from now and
+     completes tick NEXT. */
+  count = pit_read_count (0, &expired);
+  if (pit_oneshot && expired)
+    return;
+  if (!list_empty (&hr_sleepers) || interrupt_ticks == 0)
+    return;
+  next = ticks + interrupt_ticks;
+
+  /* Extend it by as many whole ticks as the counter can hold,
+     without passing an mlfqs update or a timer deadline. */
+  limit = next + (PIT_MAX_COUNT - count) / PIT_COUNTS_PER_TICK;
+  if (thread_mlfqs)
+    {
+      int64_t second = ROUND_UP (next, TIMER_FREQ);
+      if (limit > second)
+        limit = second;
+    }
+  deadline = timer_wheel_next (next, limit);
+  if (deadline == next)
+    return;
+
+  pit_start_oneshot (0, count + (deadline - next) * PIT_COUNTS_PER_TICK);
+  pit_oneshot = true;
+  interrupt_ticks += deadline - next;
+}
+
+/* Called with interrupts off when the idle thread is switched
+   out.  If the PIT is still in a postponed one-shot, accounts for
+   the ticks that have already passed and reprograms the PIT to
+   interrupt at the next tick boundary instead. */
+void
+timer_idle_exit (void) 
+{
+  unsigned count, passed;
+  bool expired;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!pit_oneshot || interrupt_ticks <= 1)
+    return;
+
+  /* If the one-shot has run out, or is about to, its interrupt is
+     pending and will account for all the ticks itself. */
+  count = pit_read_count (0, &expired);
+  if (expired || count < 64)
+    return;
+
+  /* The tick boundaries lie multiples of PIT_COUNTS_PER_TICK
+     before the end of the one-shot; those more than COUNT away
+     have passed. */
+  passed = interrupt_ticks - 1 - (count - 1) / PIT_COUNTS_PER_TICK;
+  advance_ticks (passed);
+  thread_add_idle_ticks (passed);
+  count -= (count - 1) / PIT_COUNTS_PER_TICK * PIT_COUNTS_PER_TICK;
+  pit_start_oneshot (0, count);
+  interrupt_ticks = 1;
+}
+
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
-  ticks++;
+  /* An early interrupt for a high-resolution sleeper does not end
+     a tick.  Finish the tick with another one-shot. */
+  if (interrupt_ticks == 0)
+    {
+      pit_start_oneshot (0, hr_rest);
+      interrupt_ticks = 1;
+      hr_run ();
+      return;
+    }
+
+  /* Leave tickless mode, crediting the ticks we halted through
+     to the idle thread. */
+  if (pit_oneshot)
+    {
+      pit_configure_channel (0, 2, TIMER_FREQ);
+      pit_oneshot = false;
+    }
+  if (interrupt_ticks > 1)
+    {
+      advance_ticks (interrupt_ticks - 1);
+      thread_add_idle_ticks (interrupt_ticks - 1);
+      interrupt_ticks = 1;
+    }
+
+  advance_ticks (1);
   thread_tick ();
 
   //mlfqs스케쥴러라면 매 틱 recent cpu증가시키며 load_avg, recent_cpu계산
@@ -216,12 +470,75 @@ timer_interrupt (struct intr_frame *args UNUSED)
 
   }
 
-  // 매 틱마다 깨워야 할 리스트가 존재하는지 확인한 뒤 깨워야 한다.
-  if(get_next_awake_tick() <= ticks) 
-  {
-    thread_awake(ticks);
-  }
- 
+  timer_run_wheel ();
+  hr_run ();
+}
+
+/* Adds CNT to ticks.  Interrupts must be off. */
+static void
+advance_ticks (int64_t cnt) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  seqlock_write_begin (&ticks_seqlock);
+  ticks += cnt;
+  seqlock_write_end (&ticks_seqlock);
+}
+
+/* Returns the first tick in (AFTER, LIMIT] at which a pending
+   timer is due, or LIMIT if there is none. */
+static int64_t
+timer_wheel_next (int64_t after, int64_t limit) 
+{
+  int64_t tick;
+
+  for (tick = after + 1; tick < limit; tick++)
+    {
+      struct list *slot = &timer_wheel[tick % TIMER_WHEEL_SLOTS];
+      struct list_elem *e;
+
+      for (e = list_begin (slot); e != list_end (slot); e = list_next (e))
+        if (list_entry (e, struct timer, elem)->deadline <= tick)
+          return tick;
+    }
+  return limit;
+}
+
+/* Fires the expired timers in every wheel slot from the last one
+   run up to the current tick.  Expired timers are collected
+   first, so a callback may freely add or cancel timers. */
+static void
+timer_run_wheel (void) 
+{
+  struct list expired;
+
+  list_init (&expired);
+  while (wheel_ticks < ticks)
+    {
+      struct list *slot;
+      struct list_elem *e, *next;
+
+      wheel_ticks++;
+      slot = &timer_wheel[wheel_ticks % TIMER_WHEEL_SLOTS];
+      for (e = list_begin (slot); e != list_end (slot); e = next)
+        {
+          struct timer *t = list_entry (e, struct timer, elem);
+          next = list_next (e);
+          if (t->deadline <= wheel_ticks)
+            {
+              list_remove (e);
+              list_push_back (&expired, e);
+            }
+        }
+    }
+
+  while (!list_empty (&expired))
+    {
+      struct timer *t = list_entry (list_pop_front (&expired),
+                                    struct timer, elem);
+      t->pending = false;
+      t->func (t->aux);
+    }
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -277,6 +594,11 @@ real_time_sleep (int64_t num, int32_t denom)
          processes. */                
       timer_sleep (ticks); 
     }
+  else if (tsc_mult != 0 && num * NSEC_PER_SEC / denom >= TIMER_SPIN_NS)
+    {
+      /* Block until an early timer interrupt wakes us up. */
+      hr_sleep (num * NSEC_PER_SEC / denom);
+    }
   else 
     {
       /* Otherwise, use a busy-wait loop for more accurate
@@ -289,8 +611,116 @@ real_time_sleep (int64_t num, int32_t denom)
 static void
 real_time_delay (int64_t num, int32_t denom)
 {
+  /* Once the TSC is calibrated, spin on the clock, which is
+     exact.  Before that, spin for a number of loops. */
+  if (tsc_mult != 0)
+    {
+      uint64_t deadline = timer_now_ns () + num * NSEC_PER_SEC / denom;
+      while (timer_now_ns () < deadline)
+        barrier ();
+      return;
+    }
+
   /* Scale the numerator and denominator down by 1000 to avoid
      the possibility of overflow. */
   ASSERT (denom % 1000 == 0);
   busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000)); 
 }
+
+/* Returns the CPU's time stamp counter, for measuring short
+   intervals in cycles.  See [IA32-v2b] "RDTSC". */
+uint64_t
+timer_rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Blocks the current thread for NS nanoseconds, which must be
+   less than a timer tick.  Interrupts must be turned on. */
+static void
+hr_sleep (int64_t ns) 
+{
+  struct hr_sleeper sleeper;
+  struct list_elem *e;
+  enum intr_level old_level;
+
+  ASSERT (intr_get_level () == INTR_ON);
+  ASSERT (!thread_check_idle ());
+
+  sleeper.deadline = timer_now_ns () + ns;
+  sleeper.thread = thread_current ();
+
+  old_level = intr_disable ();
+  for (e = list_begin (&hr_sleepers); e != list_end (&hr_sleepers);
+       e = list_next (e))
+    if (list_entry (e, struct hr_sleeper, elem)->deadline > sleeper.deadline)
+      break;
+  list_insert (e, &sleeper.elem);
+  hr_arm ();
+  thread_block ();
+  intr_set_level (old_level);
+}
+
+/* Wakes the high-resolution sleepers that are due and arms an
+   early interrupt for the next one.  Called from the timer
+   interrupt. */
+static void
+hr_run (void) 
+{
+  uint64_t now = timer_now_ns ();
+  bool woke = false;
+
+  while (!list_empty (&hr_sleepers))
+    {
+      struct hr_sleeper *s = list_entry (list_front (&hr_sleepers),
+                                         struct hr_sleeper, elem);
+      if (s->deadline > now + HR_SLACK_NS)
+        break;
+      list_pop_front (&hr_sleepers);
+      thread_unblock (s->thread);
+      woke = true;
+    }
+  if (woke)
+    check_list_preemption ();
+  hr_arm ();
+}
+
+/* If the first high-resolution sleeper is due before the next
+   timer interrupt, reprograms the PIT to interrupt at its
+   deadline instead, remembering how much of the tick will then
+   be left.  Interrupts must be off. */
+static void
+hr_arm (void) 
+{
+  struct hr_sleeper *s;
+  unsigned count;
+  uint64_t now, cycles;
+  bool expired;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* A tickless one-shot has no tick boundary to return to. */
+  if (list_empty (&hr_sleepers) || interrupt_ticks > 1)
+    return;
+
+  /* If a one-shot has run out, its interrupt is pending, and
+     will call us again. */
+  count = pit_read_count (0, &expired);
+  if (pit_oneshot && expired)
+    return;
+
+  s = list_entry (list_front (&hr_sleepers), struct hr_sleeper, elem);
+  now = timer_now_ns ();
+  cycles = s->deadline > now ? (s->deadline - now) * PIT_HZ / NSEC_PER_SEC : 0;
+  if (cycles < 2)
+    cycles = 2;
+  if (cycles >= count)
+    return;
+
+  hr_rest = count - cycles + (interrupt_ticks == 0 ? hr_rest : 0);
+  pit_start_oneshot (0, cycles);
+  pit_oneshot = true;
+  interrupt_ticks = 0;
+}
@@ -1,7 +1,9 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
@@ -12,6 +14,8 @@ void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
+uint64_t timer_now_ns (void);
+uint64_t timer_rdtsc (void);
 
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep (int64_t ticks);
@@ -19,11 +23,36 @@ void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
 
+/* Kernel timers.
+
+   Embed a struct timer in whatever object needs a timeout and
+   arm it with timer_add().  Once timer_ticks() reaches the
+   deadline, the callback is invoked from the timer interrupt
+   handler, so it must not sleep.  Adding and cancelling a timer
+   take constant time. */
+typedef void timer_func (void *aux);
+
+struct timer
+  {
+    struct list_elem elem;      /* Element in a timer wheel slot. */
+    int64_t deadline;           /* Tick at which to fire. */
+    timer_func *func;           /* Callback. */
+    void *aux;                  /* Passed to FUNC. */
+    bool pending;               /* Armed and not yet fired? */
+  };
+
+void timer_add (struct timer *, timer_func *, void *aux, int64_t deadline);
+bool timer_cancel (struct timer *);
+
 /* Busy waits. */
 void timer_mdelay (int64_t milliseconds);
 void timer_udelay (int64_t microseconds);
 void timer_ndelay (int64_t nanoseconds);
 
+/* Tickless idle. */
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+
 void timer_print_stats (void);
 
 #endif /* devices/timer.h */
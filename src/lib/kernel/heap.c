@@ -0,0 +1,188 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* A pairing heap is a heap-ordered multiway tree.  Each node
+   points to its leftmost child and to its right sibling, and
+   back to its left sibling, or to its parent if it is the
+   leftmost child, so that any node can be cut out of the tree in
+   constant time.  Two trees are joined ("melded") by making the
+   lesser root the leftmost child of the greater one.  Popping
+   the root melds its children pairwise, left to right, and then
+   melds the resulting trees into one, right to left, which is
+   what gives the O(log n) amortized bound.  See Fredman et al.,
+   "The Pairing Heap: A New Form of Self-Adjusting Heap",
+   Algorithmica 1 (1986). */
+
+static struct heap_elem *meld (struct heap *,
+                               struct heap_elem *, struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+
+/* Initializes HEAP as an empty heap ordered by LESS, given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *heap, heap_less_func *less, void *aux) 
+{
+  ASSERT (heap != NULL);
+  ASSERT (less != NULL);
+
+  heap->root = NULL;
+  heap->size = 0;
+  heap->less = less;
+  heap->aux = aux;
+}
+
+/* Returns true if HEAP is empty, false otherwise. */
+bool
+heap_empty (const struct heap *heap) 
+{
+  return heap->root == NULL;
+}
+
+/* Returns the number of elements in HEAP. */
+size_t
+heap_size (const struct heap *heap) 
+{
+  return heap->size;
+}
+
+/* Returns a maximal element of HEAP, or a null pointer if HEAP
+   is empty. */
+struct heap_elem *
+heap_top (const struct heap *heap) 
+{
+  return heap->root;
+}
+
+/* Inserts ELEM into HEAP. */
+void
+heap_insert (struct heap *heap, struct heap_elem *elem) 
+{
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+
+  elem->child = elem->next = elem->prev = NULL;
+  heap->root = heap->root != NULL ? meld (heap, heap->root, elem) : elem;
+  heap->size++;
+}
+
+/* Removes a maximal element from HEAP and returns it.  HEAP must
+   not be empty. */
+struct heap_elem *
+heap_pop (struct heap *heap) 
+{
+  struct heap_elem *top = heap->root;
+
+  ASSERT (top != NULL);
+
+  heap->root = merge_pairs (heap, top->child);
+  heap->size--;
+  return top;
+}
+
+/* Removes ELEM, which must be in HEAP, from HEAP. */
+void
+heap_remove (struct heap *heap, struct heap_elem *elem) 
+{
+  struct heap_elem *subtree;
+
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+  ASSERT (heap->size > 0);
+
+  if (elem == heap->root) 
+    {
+      heap_pop (heap);
+      return;
+    }
+
+  /* Cut ELEM's subtree out of the tree... */
+  if (elem->prev->child == elem)
+    elem->prev->child = elem->next;
+  else
+    elem->prev->next = elem->next;
+  if (elem->next != NULL)
+    elem->next->prev = elem->prev;
+
+  /* ...and put back everything in it but ELEM. */
+  subtree = merge_pairs (heap, elem->child);
+  if (subtree != NULL)
+    heap->root = meld (heap, heap->root, subtree);
+  heap->size--;
+}
+
+/* Restores the heap order after the key of ELEM, which must be
+   in HEAP, has changed. */
+void
+heap_update (struct heap *heap, struct heap_elem *elem) 
+{
+  heap_remove (heap, elem);
+  heap_insert (heap, elem);
+}
+
+/* Melds the trees rooted at A and B and returns the new root.
+   Ties go to A. */
+static struct heap_elem *
+meld (struct heap *heap, struct heap_elem *a, struct heap_elem *b) 
+{
+  if (heap->less (a, b, heap->aux)) 
+    {
+      struct heap_elem *tmp = a;
+      a = b;
+      b = tmp;
+    }
+
+  /* B becomes A's leftmost child. */
+  b->prev = a;
+  b->next = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  a->child = b;
+  a->next = a->prev = NULL;
+  return a;
+}
+
+/* Melds the list of sibling trees starting at FIRST into a single
+   tree and returns its root, or a null pointer if FIRST is
+   null. */
+static struct heap_elem *
+merge_pairs (struct heap *heap, struct heap_elem *first) 
+{
+  struct heap_elem *pairs = NULL;
+  struct heap_elem *root;
+
+  /* Meld the trees in pairs, left to right, stacking the results
+     on PAIRS so that the last pair ends up on top. */
+  while (first != NULL) 
+    {
+      struct heap_elem *a = first;
+      struct heap_elem *b = a->next;
+      struct heap_elem *m;
+
+      if (b == NULL) 
+        {
+          first = NULL;
+          m = a;
+        }
+      else
+        {
+          first = b->next;
+          m = meld (heap, a, b);
+        }
+      m->next = pairs;
+      pairs = m;
+    }
+  if (pairs == NULL)
+    return NULL;
+
+  /* Meld the stacked trees into one, right to left. */
+  root = pairs;
+  pairs = pairs->next;
+  while (pairs != NULL) 
+    {
+      struct heap_elem *next = pairs->next;
+      root = meld (heap, root, pairs);
+      pairs = next;
+    }
+  root->next = root->prev = NULL;
+  return root;
+}
@@ -0,0 +1,71 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Pairing heap.
+
+   A priority queue that, like the list in list.h, does not
+   require dynamically allocated memory.  Each structure that can
+   be in a heap must embed a struct heap_elem member, and
+   heap_entry() converts a struct heap_elem back to the structure
+   that contains it.
+
+   The heap is ordered by a HEAP_LESS_FUNC supplied at
+   initialization, and heap_top() returns a maximal element, that
+   is, one that no other element compares greater than.  Elements
+   that compare equal come out in unspecified order, so include a
+   tie-breaker in the comparison if, for example, FIFO order among
+   equals matters.
+
+   Costs, amortized: heap_insert() and heap_top() are O(1);
+   heap_pop(), heap_remove() and heap_update() are O(log n).
+
+   An element's key may be changed only while it is not in a
+   heap, or by calling heap_update() right afterward. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem 
+  {
+    struct heap_elem *child;    /* Leftmost child. */
+    struct heap_elem *next;     /* Right sibling. */
+    struct heap_elem *prev;     /* Left sibling, or parent if leftmost. */
+  };
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Heap. */
+struct heap 
+  {
+    struct heap_elem *root;     /* Maximal element, or null. */
+    size_t size;                /* Number of elements. */
+    heap_less_func *less;       /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)           \
+        ((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->child    \
+                     - offsetof (STRUCT, MEMBER.child)))
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+bool heap_empty (const struct heap *);
+size_t heap_size (const struct heap *);
+struct heap_elem *heap_top (const struct heap *);
+
+void heap_insert (struct heap *, struct heap_elem *);
+struct heap_elem *heap_pop (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+void heap_update (struct heap *, struct heap_elem *);
+
+#endif /* lib/kernel/heap.h */
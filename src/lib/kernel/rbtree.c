@@ -0,0 +1,364 @@
+#include "rbtree.h"
+#include "../debug.h"
+
+/* A red-black tree is a binary search tree whose nodes are
+   colored red or black such that the root is black, no red node
+   has a red child, and every path from a node down to a null
+   leaf passes through the same number of black nodes.  Together
+   these keep the height within 2 lg (n + 1).  The insertion and
+   deletion fix-ups below follow Cormen et al., "Introduction to
+   Algorithms", chapter 13, except that leaves are null pointers
+   rather than a shared sentinel, so deletion tracks the parent
+   of the possibly-null node being fixed up separately. */
+
+static void rotate_left (struct rb_tree *, struct rb_node *);
+static void rotate_right (struct rb_tree *, struct rb_node *);
+static void insert_fixup (struct rb_tree *, struct rb_node *);
+static void remove_fixup (struct rb_tree *,
+                          struct rb_node *, struct rb_node *);
+
+/* Initializes TREE as an empty tree ordered by LESS, given
+   auxiliary data AUX. */
+void
+rb_init (struct rb_tree *tree, rb_less_func *less, void *aux)
+{
+  ASSERT (tree != NULL);
+  ASSERT (less != NULL);
+
+  tree->root = tree->first = NULL;
+  tree->size = 0;
+  tree->less = less;
+  tree->aux = aux;
+}
+
+/* Returns true if TREE is empty, false otherwise. */
+bool
+rb_empty (const struct rb_tree *tree)
+{
+  return tree->root == NULL;
+}
+
+/* Returns the number of nodes in TREE. */
+size_t
+rb_size (const struct rb_tree *tree)
+{
+  return tree->size;
+}
+
+/* Returns the minimal node in TREE, or a null pointer if TREE is
+   empty. */
+struct rb_node *
+rb_first (const struct rb_tree *tree)
+{
+  return tree->first;
+}
+
+/* Returns the node that follows NODE in its tree's order, or a
+   null pointer if NODE is the last one. */
+struct rb_node *
+rb_next (const struct rb_node *node)
+{
+  ASSERT (node != NULL);
+
+  if (node->right != NULL)
+    {
+      node = node->right;
+      while (node->left != NULL)
+        node = node->left;
+      return (struct rb_node *) node;
+    }
+  while (node->parent != NULL && node == node->parent->right)
+    node = node->parent;
+  return node->parent;
+}
+
+/* Inserts NODE into TREE, after any nodes that compare equal to
+   it. */
+void
+rb_insert (struct rb_tree *tree, struct rb_node *node)
+{
+  struct rb_node **link = &tree->root;
+  struct rb_node *parent = NULL;
+  bool leftmost = true;
+
+  ASSERT (tree != NULL);
+  ASSERT (node != NULL);
+
+  while (*link != NULL)
+    {
+      parent = *link;
+      if (tree->less (node, parent, tree->aux))
+        link = &parent->left;
+      else
+        {
+          link = &parent->right;
+          leftmost = false;
+        }
+    }
+
+  node->parent = parent;
+  node->left = node->right = NULL;
+  node->red = true;
+  *link = node;
+  if (leftmost)
+    tree->first = node;
+  tree->size++;
+
+  insert_fixup (tree, node);
+}
+
+/* Replaces OLD, a child of PARENT, by NEW in TREE.  PARENT is
+   null if OLD is the root. */
+static void
+replace_child (struct rb_tree *tree, struct rb_node *parent,
+               struct rb_node *old, struct rb_node *new)
+{
+  if (parent == NULL)
+    tree->root = new;
+  else if (parent->left == old)
+    parent->left = new;
+  else
+    parent->right = new;
+}
+
+/* Puts the subtree rooted at V, which may be null, in the place
+   of the subtree rooted at U. */
+static void
+transplant (struct rb_tree *tree, struct rb_node *u, struct rb_node *v)
+{
+  replace_child (tree, u->parent, u, v);
+  if (v != NULL)
+    v->parent = u->parent;
+}
+
+/* Removes NODE, which must be in TREE, from TREE. */
+void
+rb_remove (struct rb_tree *tree, struct rb_node *node)
+{
+  struct rb_node *x, *x_parent;
+  bool removed_red = node->red;
+
+  ASSERT (tree != NULL);
+  ASSERT (node != NULL);
+  ASSERT (tree->size > 0);
+
+  if (tree->first == node)
+    tree->first = rb_next (node);
+
+  if (node->left == NULL)
+    {
+      x = node->right;
+      x_parent = node->parent;
+      transplant (tree, node, node->right);
+    }
+  else if (node->right == NULL)
+    {
+      x = node->left;
+      x_parent = node->parent;
+      transplant (tree, node, node->left);
+    }
+  else
+    {
+      /* Two children: splice out NODE's successor Y, which has
+         no left child, and put it in NODE's place. */
+      struct rb_node *y = node->right;
+      while (y->left != NULL)
+        y = y->left;
+      removed_red = y->red;
+      x = y->right;
+      if (y->parent == node)
+        x_parent = y;
+      else
+        {
+          x_parent = y->parent;
+          transplant (tree, y, y->right);
+          y->right = node->right;
+          y->right->parent = y;
+        }
+      transplant (tree, node, y);
+      y->left = node->left;
+      y->left->parent = y;
+      y->red = node->red;
+    }
+  tree->size--;
+
+  if (!removed_red)
+    remove_fixup (tree, x, x_parent);
+}
+
+/* Rotates the subtree rooted at X to the left, so that X's right
+   child takes its place. */
+static void
+rotate_left (struct rb_tree *tree, struct rb_node *x)
+{
+  struct rb_node *y = x->right;
+
+  x->right = y->left;
+  if (y->left != NULL)
+    y->left->parent = x;
+  transplant (tree, x, y);
+  y->left = x;
+  x->parent = y;
+}
+
+/* Rotates the subtree rooted at X to the right, so that X's left
+   child takes its place. */
+static void
+rotate_right (struct rb_tree *tree, struct rb_node *x)
+{
+  struct rb_node *y = x->left;
+
+  x->left = y->right;
+  if (y->right != NULL)
+    y->right->parent = x;
+  transplant (tree, x, y);
+  y->right = x;
+  x->parent = y;
+}
+
+/* Returns true if NODE is red.  Null leaves are black. */
+static inline bool
+is_red (const struct rb_node *node)
+{
+  return node != NULL && node->red;
+}
+
+/* Restores the red-black properties after red node Z has been
+   inserted into TREE. */
+static void
+insert_fixup (struct rb_tree *tree, struct rb_node *z)
+{
+  struct rb_node *p;
+
+  while ((p = z->parent) != NULL && p->red)
+    {
+      /* P is red, so it is not the root and has a parent G. */
+      struct rb_node *g = p->parent;
+
+      if (p == g->left)
+        {
+          struct rb_node *u = g->right;
+          if (is_red (u))
+            {
+              p->red = u->red = false;
+              g->red = true;
+              z = g;
+            }
+          else
+            {
+              if (z == p->right)
+                {
+                  rotate_left (tree, p);
+                  z = p;
+                  p = z->parent;
+                }
+              p->red = false;
+              g->red = true;
+              rotate_right (tree, g);
+            }
+        }
+      else
+        {
+          struct rb_node *u = g->left;
+          if (is_red (u))
+            {
+              p->red = u->red = false;
+              g->red = true;
+              z = g;
+            }
+          else
+            {
+              if (z == p->left)
+                {
+                  rotate_right (tree, p);
+                  z = p;
+                  p = z->parent;
+                }
+              p->red = false;
+              g->red = true;
+              rotate_left (tree, g);
+            }
+        }
+    }
+  tree->root->red = false;
+}
+
+/* Restores the red-black properties after a black node has been
+   removed from TREE.  X, which may be null, is the node that
+   took its place, and X_PARENT is X's parent. */
+static void
+remove_fixup (struct rb_tree *tree, struct rb_node *x,
+              struct rb_node *x_parent)
+{
+  while (x != tree->root && !is_red (x))
+    {
+      /* X carries an extra black, so its sibling W cannot be a
+         null leaf. */
+      if (x == x_parent->left)
+        {
+          struct rb_node *w = x_parent->right;
+          if (w->red)
+            {
+              w->red = false;
+              x_parent->red = true;
+              rotate_left (tree, x_parent);
+              w = x_parent->right;
+            }
+          if (!is_red (w->left) && !is_red (w->right))
+            {
+              w->red = true;
+              x = x_parent;
+              x_parent = x->parent;
+            }
+          else
+            {
+              if (!is_red (w->right))
+                {
+                  w->left->red = false;
+                  w->red = true;
+                  rotate_right (tree, w);
+                  w = x_parent->right;
+                }
+              w->red = x_parent->red;
+              x_parent->red = false;
+              w->right->red = false;
+              rotate_left (tree, x_parent);
+              x = tree->root;
+            }
+        }
+      else
+        {
+          struct rb_node *w = x_parent->left;
+          if (w->red)
+            {
+              w->red = false;
+              x_parent->red = true;
+              rotate_right (tree, x_parent);
+              w = x_parent->left;
+            }
+          if (!is_red (w->left) && !is_red (w->right))
+            {
+              w->red = true;
+              x = x_parent;
+              x_parent = x->parent;
+            }
+          else
+            {
+              if (!is_red (w->left))
+                {
+                  w->right->red = false;
+                  w->red = true;
+                  rotate_left (tree, w);
+                  w = x_parent->left;
+                }
+              w->red = x_parent->red;
+              x_parent->red = false;
+              w->left->red = false;
+              rotate_right (tree, x_parent);
+              x = tree->root;
+            }
+        }
+    }
+  if (x != NULL)
+    x->red = false;
+}
@@ -0,0 +1,68 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+
+   A balanced binary search tree that, like the list in list.h,
+   does not require dynamically allocated memory.  Each structure
+   that can be in a tree must embed a struct rb_node member, and
+   rb_entry() converts a struct rb_node back to the structure
+   that contains it.
+
+   The tree is ordered by an RB_LESS_FUNC supplied at
+   initialization.  Elements that compare equal are kept in
+   insertion order.  The tree caches its minimal element, so
+   rb_first() is O(1); rb_insert() and rb_remove() are
+   O(log n).
+
+   An element's key may be changed only while it is not in a
+   tree. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Tree node. */
+struct rb_node
+  {
+    struct rb_node *parent;     /* Parent, or null for the root. */
+    struct rb_node *left;       /* Left child. */
+    struct rb_node *right;      /* Right child. */
+    bool red;                   /* Red or black? */
+  };
+
+/* Compares the value of two tree nodes A and B, given auxiliary
+   data AUX.  Returns true if A is less than B, or false if A is
+   greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_node *a,
+                           const struct rb_node *b,
+                           void *aux);
+
+/* Tree. */
+struct rb_tree
+  {
+    struct rb_node *root;       /* Root, or null. */
+    struct rb_node *first;      /* Minimal node, or null. */
+    size_t size;                /* Number of nodes. */
+    rb_less_func *less;         /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+/* Converts pointer to tree node RB_NODE into a pointer to the
+   structure that RB_NODE is embedded inside.  Supply the name of
+   the outer structure STRUCT and the member name MEMBER of the
+   tree node. */
+#define rb_entry(RB_NODE, STRUCT, MEMBER)               \
+        ((STRUCT *) ((uint8_t *) &(RB_NODE)->parent     \
+                     - offsetof (STRUCT, MEMBER.parent)))
+
+void rb_init (struct rb_tree *, rb_less_func *, void *aux);
+bool rb_empty (const struct rb_tree *);
+size_t rb_size (const struct rb_tree *);
+struct rb_node *rb_first (const struct rb_tree *);
+struct rb_node *rb_next (const struct rb_node *);
+
+void rb_insert (struct rb_tree *, struct rb_node *);
+void rb_remove (struct rb_tree *, struct rb_node *);
+
+#endif /* lib/kernel/rbtree.h */
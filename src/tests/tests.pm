@@ -33,6 +33,21 @@ sub check_expected {
     compare_output ("run", @options, \@output, $expected);
 }
 
+# Checks that the output contains a line matching each of
+# PATTERNS, for tests that print measurements that vary from run
+# to run and so cannot be compared with check_expected().
+sub check_lines {
+    my (@patterns) = @_;
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output);
+    foreach my $pattern (@patterns) {
+	fail "Missing output matching $pattern.\n"
+	  if !grep (/$pattern/, @output);
+    }
+    pass;
+}
+
 sub common_checks {
     my ($run, @output) = @_;
 
@@ -0,0 +1,73 @@
+/* Checks the high-resolution clock and sub-tick sleeps.
+
+   timer_now_ns() must never go backward.  A sleep of less than a
+   timer tick must last at least as long as asked, must end well
+   before the next tick would have ended it, and must block, so
+   that a lower-priority thread gets to run in the meantime. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEP_US 2000           /* Length of the sleep. */
+#define TICK_NS (1000000000 / TIMER_FREQ)
+
+static thread_func spinner;
+
+static volatile bool stop;
+static volatile int spins;
+static struct semaphore done;
+
+void
+test_alarm_hires (void) 
+{
+  uint64_t prev, start, elapsed;
+  bool monotonic = true;
+  int i;
+
+  prev = timer_now_ns ();
+  for (i = 0; i < 10000; i++)
+    {
+      uint64_t now = timer_now_ns ();
+      if (now < prev)
+        monotonic = false;
+      prev = now;
+    }
+  msg (monotonic ? "Clock never went backward." : "Clock went backward.");
+
+  sema_init (&done, 0);
+  thread_create ("spinner", PRI_DEFAULT - 1, spinner, NULL);
+
+  start = timer_now_ns ();
+  timer_usleep (SLEEP_US);
+  elapsed = timer_now_ns () - start;
+  stop = true;
+
+  if (elapsed >= SLEEP_US * 1000)
+    msg ("Sleep lasted long enough.");
+  else
+    msg ("Sleep lasted only %"PRIu64" ns.", elapsed);
+  if (elapsed < SLEEP_US * 1000 + TICK_NS / 2)
+    msg ("Sleep ended well before the next tick.");
+  else
+    msg ("Sleep lasted %"PRIu64" ns.", elapsed);
+  if (spins > 0)
+    msg ("Lower-priority thread ran during the sleep.");
+  else
+    msg ("Lower-priority thread did not run during the sleep.");
+
+  sema_down (&done);
+}
+
+/* Counts until told to stop. */
+static void
+spinner (void *aux UNUSED) 
+{
+  while (!stop)
+    spins++;
+  sema_up (&done);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-hires) begin
+(alarm-hires) Clock never went backward.
+(alarm-hires) Sleep lasted long enough.
+(alarm-hires) Sleep ended well before the next tick.
+(alarm-hires) Lower-priority thread ran during the sleep.
+(alarm-hires) end
+EOF
+pass;
@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_lines (qr/lock_acquire \+ lock_release: \d+ cycles\./,
+             qr/sema_down \+ sema_up: \d+ cycles\./);
@@ -0,0 +1,62 @@
+/* Reports the throughput of malloc() and free() for two
+   patterns: "ping-pong", which allocates and immediately frees
+   a block of one size, like the bounce buffers in
+   inode_read_at(), and "batch", which allocates a batch of
+   blocks of mixed sizes and then frees them all.  Costs are in
+   time-stamp counter cycles per malloc() and free() pair.
+   Also checks that live blocks are not handed out twice. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "devices/timer.h"
+
+#define PING_PONG_CNT 100000
+#define BATCH_CNT 1000
+#define BATCH_SIZE 64
+
+static int *blocks[BATCH_SIZE];
+
+void
+test_malloc_throughput (void) 
+{
+  uint64_t start, ping_pong_cycles, batch_cycles;
+  int i, j;
+
+  start = timer_rdtsc ();
+  for (i = 0; i < PING_PONG_CNT; i++) 
+    {
+      void *p = malloc (512);
+      if (p == NULL)
+        fail ("malloc failed");
+      free (p);
+    }
+  ping_pong_cycles = timer_rdtsc () - start;
+
+  start = timer_rdtsc ();
+  for (i = 0; i < BATCH_CNT; i++) 
+    {
+      for (j = 0; j < BATCH_SIZE; j++) 
+        {
+          /* Sizes from 16 to 1024 bytes. */
+          blocks[j] = malloc (16 << (j % 7));
+          if (blocks[j] == NULL)
+            fail ("malloc failed");
+          *blocks[j] = j;
+        }
+      for (j = 0; j < BATCH_SIZE; j++) 
+        {
+          if (*blocks[j] != j)
+            fail ("block %d was handed out twice", j);
+          free (blocks[j]);
+        }
+    }
+  batch_cycles = timer_rdtsc () - start;
+
+  msg ("ping-pong: %"PRIu64" cycles per malloc + free.",
+       ping_pong_cycles / PING_PONG_CNT);
+  msg ("batch: %"PRIu64" cycles per malloc + free.",
+       batch_cycles / (BATCH_CNT * BATCH_SIZE));
+}
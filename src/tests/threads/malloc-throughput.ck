@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_lines (qr/ping-pong: \d+ cycles per malloc \+ free\./,
+             qr/batch: \d+ cycles per malloc \+ free\./);
@@ -0,0 +1,110 @@
+/* Reports the latency of palloc_get_multiple() under a workload
+   that fragments the pool: a random mix of 1- to 8-page
+   allocations, most of them small, is allocated and freed in
+   random order.  Latencies are in time-stamp counter cycles.
+   Also checks that no page is handed out twice. */
+
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define SLOT_CNT 48             /* Allocations live at once, at most. */
+#define OP_CNT 4000             /* Allocations and frees. */
+
+/* A live allocation. */
+struct slot
+  {
+    uint8_t *pages;             /* First page, or null. */
+    size_t page_cnt;            /* Number of pages. */
+  };
+
+static struct slot slots[SLOT_CNT];
+static uint32_t latencies[OP_CNT];
+
+static int
+compare_latency (const void *a_, const void *b_) 
+{
+  const uint32_t *a = a_;
+  const uint32_t *b = b_;
+
+  return *a < *b ? -1 : *a > *b;
+}
+
+/* Marks each page of S with the index of S. */
+static void
+stamp (struct slot *s, unsigned idx) 
+{
+  size_t i;
+
+  for (i = 0; i < s->page_cnt; i++)
+    *(unsigned *) (s->pages + i * PGSIZE) = idx;
+}
+
+/* Fails unless each page of S is marked with the index of S. */
+static void
+check_stamp (struct slot *s, unsigned idx) 
+{
+  size_t i;
+
+  for (i = 0; i < s->page_cnt; i++)
+    if (*(unsigned *) (s->pages + i * PGSIZE) != idx)
+      fail ("page %zu of allocation %u was overwritten", i, idx);
+}
+
+void
+test_palloc_latency (void) 
+{
+  size_t alloc_cnt = 0, fail_cnt = 0;
+  int op;
+  unsigned i;
+
+  random_init (0);
+  for (op = 0; op < OP_CNT; op++) 
+    {
+      unsigned idx = random_ulong () % SLOT_CNT;
+      struct slot *s = &slots[idx];
+
+      if (s->pages != NULL) 
+        {
+          check_stamp (s, idx);
+          palloc_free_multiple (s->pages, s->page_cnt);
+          s->pages = NULL;
+        }
+      else 
+        {
+          uint64_t start;
+
+          /* Three quarters of allocations are 1 or 2 pages. */
+          s->page_cnt = (random_ulong () % 4 != 0
+                         ? 1 + random_ulong () % 2
+                         : 3 + random_ulong () % 6);
+          start = timer_rdtsc ();
+          s->pages = palloc_get_multiple (PAL_USER, s->page_cnt);
+          latencies[alloc_cnt++] = timer_rdtsc () - start;
+          if (s->pages == NULL)
+            fail_cnt++;
+          else
+            stamp (s, idx);
+        }
+    }
+
+  for (i = 0; i < SLOT_CNT; i++)
+    if (slots[i].pages != NULL) 
+      {
+        check_stamp (&slots[i], i);
+        palloc_free_multiple (slots[i].pages, slots[i].page_cnt);
+      }
+
+  qsort (latencies, alloc_cnt, sizeof *latencies, compare_latency);
+  msg ("%zu allocations, %zu failed.", alloc_cnt, fail_cnt);
+  msg ("Latency percentiles: 50th %"PRIu32", 90th %"PRIu32", "
+       "99th %"PRIu32", max %"PRIu32" cycles.",
+       latencies[alloc_cnt * 50 / 100], latencies[alloc_cnt * 90 / 100],
+       latencies[alloc_cnt * 99 / 100], latencies[alloc_cnt - 1]);
+}
@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_lines (qr/\d+ allocations, 0 failed\./,
+             qr/Latency percentiles: 50th \d+, 90th \d+, 99th \d+, max \d+ cycles\./);
@@ -0,0 +1,74 @@
+/* Checks that pages allocated with PAL_ZERO are zeroed, whether
+   they come from the idle thread's pre-zeroed pages or not, and
+   reports how long each kind takes to allocate.  Latencies are
+   in time-stamp counter cycles. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define PAGE_CNT 48             /* More than the idle thread keeps. */
+#define ROUND_CNT 2             /* Rounds of allocation. */
+
+static uint8_t *pages[PAGE_CNT];
+static uint32_t latencies[PAGE_CNT];
+
+/* Returns the sum of latencies[FIRST] up to latencies[LAST]. */
+static uint64_t
+sum_latencies (int first, int last) 
+{
+  uint64_t sum = 0;
+  int i;
+
+  for (i = first; i <= last; i++)
+    sum += latencies[i];
+  return sum;
+}
+
+void
+test_palloc_zero (void) 
+{
+  int round, i;
+
+  for (round = 0; round < ROUND_CNT; round++) 
+    {
+      /* Give the idle thread time to zero some pages. */
+      timer_msleep (100);
+
+      for (i = 0; i < PAGE_CNT; i++) 
+        {
+          uint64_t start = timer_rdtsc ();
+          pages[i] = palloc_get_page (PAL_ZERO);
+          latencies[i] = timer_rdtsc () - start;
+          if (pages[i] == NULL)
+            fail ("out of pages after %d allocations", i);
+        }
+
+      /* Check, then dirty the pages, so that the next round
+         sees zeroes only if they were zeroed again. */
+      for (i = 0; i < PAGE_CNT; i++) 
+        {
+          size_t ofs;
+
+          for (ofs = 0; ofs < PGSIZE; ofs++)
+            if (pages[i][ofs] != 0)
+              fail ("round %d, page %d: byte %zu is nonzero",
+                    round, i, ofs);
+          memset (pages[i], 0xa5, PGSIZE);
+        }
+      for (i = 0; i < PAGE_CNT; i++)
+        palloc_free_page (pages[i]);
+    }
+
+  /* The first allocations come off the pre-zeroed pages, the
+     last ones have to be zeroed on demand. */
+  msg ("All pages zeroed.");
+  msg ("Average latency: first 8 %"PRIu64", last 8 %"PRIu64" cycles.",
+       sum_latencies (0, 7) / 8,
+       sum_latencies (PAGE_CNT - 8, PAGE_CNT - 1) / 8);
+}
@@ -0,0 +1,103 @@
+/* Stress test for readers-writer locks.  Several readers keep
+   the lock held for reading, each sleeping inside its read
+   section so that their sections overlap and the number of
+   readers never drops to zero on its own.  The main thread then
+   repeatedly acquires the lock for writing.
+
+   Without writer preference the writer would starve.  With it,
+   the writer gets in within one read section, no reader enters
+   while it writes, and every reader gets to read again once it
+   leaves. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define READER_CNT 4            /* Number of reader threads. */
+#define ROUND_CNT 5             /* Number of times to write. */
+#define READ_TICKS 3            /* Ticks each reader spends reading. */
+
+static thread_func reader_thread;
+
+static struct rwlock rwlock;
+static struct semaphore done;
+static bool stop;
+static int active_readers;
+static int max_active_readers;
+static int read_cnt[READER_CNT];
+
+void
+test_priority_rwlock_fair (void) 
+{
+  int i, round;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rwlock_init (&rwlock);
+  sema_init (&done, 0);
+  for (i = 0; i < READER_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT, reader_thread, &read_cnt[i]);
+    }
+
+  for (round = 0; round < ROUND_CNT; round++) 
+    {
+      int before[READER_CNT];
+      int64_t start;
+
+      timer_sleep (4 * READ_TICKS);
+      start = timer_ticks ();
+      rwlock_acquire_write (&rwlock);
+      if (timer_elapsed (start) > 2 * READ_TICKS)
+        fail ("writer waited %"PRId64" ticks for the readers",
+              timer_elapsed (start));
+      if (active_readers != 0)
+        fail ("writer got the lock with %d readers", active_readers);
+
+      for (i = 0; i < READER_CNT; i++)
+        before[i] = read_cnt[i];
+      timer_sleep (2 * READ_TICKS);
+      for (i = 0; i < READER_CNT; i++)
+        if (read_cnt[i] != before[i])
+          fail ("reader %d read while the writer held the lock", i);
+      rwlock_release_write (&rwlock);
+
+      timer_sleep (4 * READ_TICKS);
+      for (i = 0; i < READER_CNT; i++)
+        if (read_cnt[i] == before[i])
+          fail ("reader %d did not read after the writer left", i);
+      msg ("Round %d: writer got in, then every reader read again.", round);
+    }
+
+  stop = true;
+  for (i = 0; i < READER_CNT; i++)
+    sema_down (&done);
+  if (max_active_readers < 2)
+    fail ("readers never shared the lock");
+  msg ("Readers shared the lock.");
+}
+
+static void
+reader_thread (void *read_cnt_) 
+{
+  int *read_cnt = read_cnt_;
+
+  while (!stop) 
+    {
+      rwlock_acquire_read (&rwlock);
+      (*read_cnt)++;
+      if (++active_readers > max_active_readers)
+        max_active_readers = active_readers;
+      timer_sleep (READ_TICKS);
+      active_readers--;
+      rwlock_release_read (&rwlock);
+    }
+  sema_up (&done);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-rwlock-fair) begin
+(priority-rwlock-fair) Round 0: writer got in, then every reader read again.
+(priority-rwlock-fair) Round 1: writer got in, then every reader read again.
+(priority-rwlock-fair) Round 2: writer got in, then every reader read again.
+(priority-rwlock-fair) Round 3: writer got in, then every reader read again.
+(priority-rwlock-fair) Round 4: writer got in, then every reader read again.
+(priority-rwlock-fair) Readers shared the lock.
+(priority-rwlock-fair) end
+EOF
+pass;
@@ -0,0 +1,98 @@
+/* Measures the cost of sema_up() as the number of threads
+   waiting on the semaphore grows from 1 to 1000.  The waiters
+   have mixed priorities, so sema_up() must pick the best of
+   them; with priority-ordered wait queues the cost per wakeup
+   should stay roughly flat.
+
+   Each round, the main thread ups the semaphore once per waiter,
+   timing each call with the CPU's time-stamp counter, then drops
+   its priority so that the woken waiters can run and wait again. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static thread_func waiter_thread;
+static uint64_t measure (int waiter_cnt);
+static void let_waiters_run (void);
+
+static struct semaphore sema;
+static bool stop;
+static int exit_cnt;
+
+void
+test_priority_sema_scale (void) 
+{
+  static const int sizes[] = {1, 10, 100, 1000};
+  size_t i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    msg ("%d waiters: %"PRIu64" cycles per sema_up.",
+         sizes[i], measure (sizes[i]));
+}
+
+/* Creates WAITER_CNT threads waiting on SEMA and returns the
+   average number of cycles sema_up() takes to wake one. */
+static uint64_t
+measure (int waiter_cnt) 
+{
+  int round_cnt = 8 + 4000 / waiter_cnt;
+  uint64_t cycles = 0;
+  int i, round;
+
+  sema_init (&sema, 0);
+  stop = false;
+  exit_cnt = 0;
+  for (i = 0; i < waiter_cnt; i++) 
+    {
+      char name[sizeof "waiter -2147483648"];
+      snprintf (name, sizeof name, "waiter %d", i);
+      thread_create (name, PRI_DEFAULT - 1 - i % 16, waiter_thread, NULL);
+    }
+  let_waiters_run ();
+
+  for (round = 0; round < round_cnt; round++) 
+    {
+      for (i = 0; i < waiter_cnt; i++) 
+        {
+          uint64_t start = timer_rdtsc ();
+          sema_up (&sema);
+          cycles += timer_rdtsc () - start;
+        }
+      let_waiters_run ();
+    }
+
+  stop = true;
+  for (i = 0; i < waiter_cnt; i++)
+    sema_up (&sema);
+  let_waiters_run ();
+  if (exit_cnt != waiter_cnt)
+    fail ("only %d of %d waiters exited", exit_cnt, waiter_cnt);
+
+  return cycles / ((uint64_t) waiter_cnt * round_cnt);
+}
+
+/* Lets every ready waiter run until it waits on SEMA again (or
+   exits), since they all have lower priority than us. */
+static void
+let_waiters_run (void) 
+{
+  thread_set_priority (PRI_MIN);
+  thread_set_priority (PRI_DEFAULT);
+}
+
+static void
+waiter_thread (void *aux UNUSED) 
+{
+  do
+    sema_down (&sema);
+  while (!stop);
+  exit_cnt++;
+}
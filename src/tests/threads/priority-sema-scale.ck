@@ -0,0 +1,30 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my (%cycles);
+local ($_);
+foreach (@output) {
+    my ($waiters, $cycles) = /(\d+) waiters: (\d+) cycles per sema_up\./
+      or next;
+    $cycles{$waiters} = $cycles;
+}
+
+foreach my $waiters (1, 10, 100, 1000) {
+    fail "No measurement for $waiters waiters.\n"
+      if !defined $cycles{$waiters};
+}
+
+# Waking one of 1000 waiters should cost about as much as waking
+# the only one.  Allow generous slack for simulator noise.
+my ($min, $max) = (sort { $a <=> $b } values %cycles)[0, -1];
+$min = 1 if $min < 1;
+fail "sema_up() cost grew from $min to $max cycles per wakeup "
+  . "as waiters increased from 1 to 1000.\n"
+  if $max > 4 * $min;
+pass;
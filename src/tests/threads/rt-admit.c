@@ -0,0 +1,70 @@
+/* Checks admission control for real-time threads.  Threads are
+   admitted as long as the sum of their budget / period stays at
+   most 1, and the share of a thread that exits can be handed
+   out again. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static thread_func waiter;
+
+static struct semaphore go;
+static struct semaphore done;
+static int waiter_cnt;
+
+static void try_create (int64_t period, int64_t budget);
+
+void
+test_rt_admit (void) 
+{
+  int i;
+
+  sema_init (&go, 0);
+  sema_init (&done, 0);
+
+  try_create (8, 4);
+  try_create (8, 3);
+  try_create (8, 2);
+  try_create (8, 1);
+  try_create (100, 1);
+
+  msg ("Letting the admitted threads exit.");
+  for (i = 0; i < waiter_cnt; i++)
+    sema_up (&go);
+  for (i = 0; i < waiter_cnt; i++)
+    sema_down (&done);
+  waiter_cnt = 0;
+
+  try_create (8, 8);
+  sema_up (&go);
+  sema_down (&done);
+}
+
+/* Tries to create a real-time thread with the given PERIOD and
+   BUDGET, and reports whether it was admitted. */
+static void
+try_create (int64_t period, int64_t budget) 
+{
+  char name[16];
+
+  snprintf (name, sizeof name, "rt %d/%d", (int) period, (int) budget);
+  if (thread_create_rt (name, period, budget, waiter, NULL) != TID_ERROR) 
+    {
+      waiter_cnt++;
+      msg ("%s admitted.", name);
+    }
+  else
+    msg ("%s refused.", name);
+}
+
+/* Holds on to its share of the CPU until told to exit. */
+static void
+waiter (void *aux UNUSED) 
+{
+  sema_down (&go);
+  sema_up (&done);
+}
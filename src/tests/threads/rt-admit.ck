@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rt-admit) begin
+(rt-admit) rt 8/4 admitted.
+(rt-admit) rt 8/3 admitted.
+(rt-admit) rt 8/2 refused.
+(rt-admit) rt 8/1 admitted.
+(rt-admit) rt 100/1 refused.
+(rt-admit) Letting the admitted threads exit.
+(rt-admit) rt 8/8 admitted.
+(rt-admit) end
+EOF
+pass;
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rt-deadline-mlfqs) begin
+(rt-deadline-mlfqs) rt 10/4: 40 jobs, 0 deadline misses.
+(rt-deadline-mlfqs) rt 20/6: 20 jobs, 0 deadline misses.
+(rt-deadline-mlfqs) rt 40/8: 10 jobs, 0 deadline misses.
+(rt-deadline-mlfqs) hog was not starved.
+(rt-deadline-mlfqs) end
+EOF
+pass;
@@ -0,0 +1,139 @@
+/* Checks that real-time threads meet their deadlines while a
+   CPU-bound thread of the highest priority runs in the
+   background.
+
+   Three periodic real-time threads each run a job of WORK timer
+   ticks in every period and then sleep until the next one.  Their
+   budgets cover the work with a tick to spare, and their
+   utilizations sum to 0.9, so earliest-deadline-first scheduling
+   must finish every job before the end of its period.  The hog
+   must still get what the real-time threads leave over.
+
+   rt-deadline-mlfqs runs the same test under the advanced
+   scheduler, whose once-a-second recalculation must leave the
+   real-time threads alone. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define RUN_TICKS 400           /* Length of the measurement. */
+
+struct rt_task
+  {
+    const char *name;
+    int64_t period;             /* Period, in ticks. */
+    int64_t budget;             /* Budget per period, in ticks. */
+    int work;                   /* Ticks of work per job. */
+    int job_cnt;                /* Jobs run. */
+    int miss_cnt;               /* Jobs finished after their deadline. */
+  };
+
+static struct rt_task tasks[] =
+  {
+    {"rt 10/4", 10, 4, 2, 0, 0},
+    {"rt 20/6", 20, 6, 3, 0, 0},
+    {"rt 40/8", 40, 8, 4, 0, 0},
+  };
+#define TASK_CNT (sizeof tasks / sizeof *tasks)
+
+static void rt_deadline (void);
+static thread_func rt_thread;
+static thread_func hog_thread;
+
+static int64_t start;
+static int hog_ticks;
+static struct semaphore done;
+
+void
+test_rt_deadline (void) 
+{
+  rt_deadline ();
+}
+
+void
+test_rt_deadline_mlfqs (void) 
+{
+  ASSERT (thread_mlfqs);
+  rt_deadline ();
+}
+
+static void
+rt_deadline (void) 
+{
+  size_t i;
+
+  sema_init (&done, 0);
+  start = timer_ticks () + 10;
+
+  for (i = 0; i < TASK_CNT; i++)
+    if (thread_create_rt (tasks[i].name, tasks[i].period, tasks[i].budget,
+                          rt_thread, &tasks[i]) == TID_ERROR)
+      fail ("admission of \"%s\" failed", tasks[i].name);
+
+  /* The hog outranks us, so we only get back here once it is
+     done. */
+  thread_create ("hog", PRI_MAX, hog_thread, NULL);
+
+  for (i = 0; i < TASK_CNT; i++)
+    sema_down (&done);
+  for (i = 0; i < TASK_CNT; i++)
+    msg ("%s: %d jobs, %d deadline misses.",
+         tasks[i].name, tasks[i].job_cnt, tasks[i].miss_cnt);
+  if (hog_ticks >= RUN_TICKS / 4)
+    msg ("hog was not starved.");
+  else
+    msg ("hog got only %d of %d ticks.", hog_ticks, RUN_TICKS);
+}
+
+/* Runs one job per period until RUN_TICKS have passed. */
+static void
+rt_thread (void *task_) 
+{
+  struct rt_task *task = task_;
+  int64_t release;
+
+  for (release = start; release < start + RUN_TICKS;
+       release += task->period)
+    {
+      int64_t last_time;
+      int work;
+
+      timer_sleep (release - timer_ticks ());
+
+      last_time = timer_ticks ();
+      for (work = 0; work < task->work; )
+        {
+          int64_t cur_time = timer_ticks ();
+          if (cur_time != last_time)
+            work++;
+          last_time = cur_time;
+        }
+
+      task->job_cnt++;
+      if (timer_ticks () > release + task->period)
+        task->miss_cnt++;
+    }
+  sema_up (&done);
+}
+
+/* Spins from the start of the measurement until past its end,
+   counting the ticks it sees during the measurement. */
+static void
+hog_thread (void *aux UNUSED) 
+{
+  int64_t last_time = 0;
+
+  while (timer_ticks () < start)
+    continue;
+  while (timer_ticks () < start + RUN_TICKS + 50) 
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time && cur_time < start + RUN_TICKS)
+        hog_ticks++;
+      last_time = cur_time;
+    }
+}
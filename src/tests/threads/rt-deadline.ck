@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rt-deadline) begin
+(rt-deadline) rt 10/4: 40 jobs, 0 deadline misses.
+(rt-deadline) rt 20/6: 20 jobs, 0 deadline misses.
+(rt-deadline) rt 40/8: 10 jobs, 0 deadline misses.
+(rt-deadline) hog was not starved.
+(rt-deadline) end
+EOF
+pass;
@@ -0,0 +1,79 @@
+/* Checks that a real-time thread that runs over its budget is
+   throttled.  A real-time thread with a budget of 3 ticks in
+   every period of 10 spins without ever sleeping, while the main
+   thread, which is not real-time, spins alongside it.  The
+   real-time thread must get no more than its share of the CPU,
+   and the main thread the rest. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define PERIOD 10
+#define BUDGET 3
+#define RUN_TICKS 300           /* Length of the measurement. */
+#define SLACK 10                /* Allowed error, in ticks. */
+
+static thread_func greedy_thread;
+
+static int64_t start;
+static struct semaphore done;
+
+static int spin (void);
+
+void
+test_rt_throttle (void) 
+{
+  int greedy_ticks, main_ticks;
+
+  sema_init (&done, 0);
+  start = timer_ticks () + 5;
+
+  if (thread_create_rt ("greedy", PERIOD, BUDGET, greedy_thread,
+                        &greedy_ticks) == TID_ERROR)
+    fail ("admission failed");
+  main_ticks = spin ();
+  sema_down (&done);
+
+  if (greedy_ticks <= RUN_TICKS * BUDGET / PERIOD + SLACK)
+    msg ("Real-time thread stayed within its budget.");
+  else
+    msg ("Real-time thread got %d of %d ticks.", greedy_ticks, RUN_TICKS);
+  if (main_ticks >= RUN_TICKS * (PERIOD - BUDGET) / PERIOD - SLACK)
+    msg ("Main thread got the rest of the CPU.");
+  else
+    msg ("Main thread got only %d of %d ticks.", main_ticks, RUN_TICKS);
+}
+
+static void
+greedy_thread (void *ticks_) 
+{
+  int *ticks = ticks_;
+
+  *ticks = spin ();
+  sema_up (&done);
+}
+
+/* Spins from START until START + RUN_TICKS and returns the number
+   of ticks seen in the meantime. */
+static int
+spin (void) 
+{
+  int64_t last_time;
+  int ticks = 0;
+
+  while (timer_ticks () < start)
+    continue;
+  last_time = start;
+  while (timer_ticks () < start + RUN_TICKS) 
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        ticks++;
+      last_time = cur_time;
+    }
+  return ticks;
+}
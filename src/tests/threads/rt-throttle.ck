@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rt-throttle) begin
+(rt-throttle) Real-time thread stayed within its budget.
+(rt-throttle) Main thread got the rest of the CPU.
+(rt-throttle) end
+EOF
+pass;
@@ -0,0 +1,99 @@
+/* Checks that an object cache returns aligned, distinct objects,
+   runs the constructor once per object rather than on every
+   allocation, and colors its slabs. */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+
+#define OBJ_CNT 200
+#define OBJ_MAGIC 0x0b1ec7
+
+/* An object with a size that malloc() would round up. */
+struct obj
+  {
+    unsigned magic;             /* Set by the constructor. */
+    int value;                  /* Set by the test. */
+    char pad[92];
+  };
+
+static struct obj *objs[OBJ_CNT];
+static int ctor_cnt;
+
+static void
+obj_ctor (void *obj_) 
+{
+  struct obj *obj = obj_;
+
+  obj->magic = OBJ_MAGIC;
+  obj->value = -1;
+  ctor_cnt++;
+}
+
+void
+test_slab_cache (void) 
+{
+  struct kmem_cache *cache;
+  struct obj *obj;
+  uintptr_t first_ofs = 0;
+  bool colored = false;
+  int i, j, cnt;
+
+  cache = kmem_cache_create ("slab-cache", sizeof (struct obj), 16,
+                             obj_ctor);
+  if (cache == NULL)
+    fail ("kmem_cache_create failed");
+
+  for (i = 0; i < OBJ_CNT; i++) 
+    {
+      obj = objs[i] = kmem_cache_alloc (cache);
+      if (obj == NULL)
+        fail ("allocation %d failed", i);
+      if ((uintptr_t) obj % 16 != 0)
+        fail ("object %p is not 16-byte aligned", obj);
+      if (obj->magic != OBJ_MAGIC || obj->value != -1)
+        fail ("object %p was not constructed", obj);
+      obj->value = i;
+
+      /* Compare where the first object of each slab lies. */
+      if (i == 0)
+        first_ofs = pg_ofs (obj);
+      else if (pg_round_down (obj) != pg_round_down (objs[i - 1])
+               && pg_ofs (obj) != first_ofs)
+        colored = true;
+    }
+  msg ("Allocated %d aligned, constructed objects.", OBJ_CNT);
+
+  for (i = 0; i < OBJ_CNT; i++) 
+    {
+      if (objs[i]->value != i)
+        fail ("object %d was overwritten", i);
+      for (j = 0; j < i; j++)
+        if ((uint8_t *) objs[i] < (uint8_t *) objs[j] + sizeof (struct obj)
+            && (uint8_t *) objs[j] < (uint8_t *) objs[i] + sizeof (struct obj))
+          fail ("objects %d and %d overlap", j, i);
+    }
+  msg ("Objects are distinct.");
+
+  if (!colored)
+    fail ("all slabs start their objects at offset %#"PRIxPTR, first_ofs);
+  msg ("Slabs are colored.");
+
+  /* A freed object comes back in the state it was freed in. */
+  cnt = ctor_cnt;
+  obj = objs[0];
+  kmem_cache_free (cache, obj);
+  objs[0] = kmem_cache_alloc (cache);
+  if (objs[0] != obj)
+    fail ("did not get the freed object back");
+  if (obj->value != 0 || ctor_cnt != cnt)
+    fail ("object was constructed again");
+  msg ("Constructor ran once per object.");
+
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (cache, objs[i]);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(slab-cache) begin
+(slab-cache) Allocated 200 aligned, constructed objects.
+(slab-cache) Objects are distinct.
+(slab-cache) Slabs are colored.
+(slab-cache) Constructor ran once per object.
+(slab-cache) end
+EOF
+pass;
@@ -25,10 +25,14 @@ static const struct test tests[] =
     {"priority-donate-sema", test_priority_donate_sema},
     {"priority-donate-lower", test_priority_donate_lower},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"priority-donate-rwlock", test_priority_donate_rwlock},
+    {"priority-rwlock-fair", test_priority_rwlock_fair},
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"priority-sema-scale", test_priority_sema_scale},
+    {"lock-uncontended", test_lock_uncontended},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -38,6 +42,20 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"cfs-fair-2", test_cfs_fair_2},
+    {"cfs-fair-20", test_cfs_fair_20},
+    {"cfs-nice-2", test_cfs_nice_2},
+    {"cfs-nice-10", test_cfs_nice_10},
+    {"rt-deadline", test_rt_deadline},
+    {"rt-deadline-mlfqs", test_rt_deadline_mlfqs},
+    {"rt-admit", test_rt_admit},
+    {"rt-throttle", test_rt_throttle},
+    {"thread-stats", test_thread_stats},
+    {"alarm-hires", test_alarm_hires},
+    {"palloc-latency", test_palloc_latency},
+    {"slab-cache", test_slab_cache},
+    {"malloc-throughput", test_malloc_throughput},
+    {"palloc-zero", test_palloc_zero},
   };
 
 static const char *test_name;
@@ -19,10 +19,14 @@ extern test_func test_priority_donate_sema;
 extern test_func test_priority_donate_nest;
 extern test_func test_priority_donate_lower;
 extern test_func test_priority_donate_chain;
+extern test_func test_priority_donate_rwlock;
+extern test_func test_priority_rwlock_fair;
 extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_priority_sema_scale;
+extern test_func test_lock_uncontended;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -32,6 +36,20 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_cfs_fair_2;
+extern test_func test_cfs_fair_20;
+extern test_func test_cfs_nice_2;
+extern test_func test_cfs_nice_10;
+extern test_func test_rt_deadline;
+extern test_func test_rt_deadline_mlfqs;
+extern test_func test_rt_admit;
+extern test_func test_rt_throttle;
+extern test_func test_thread_stats;
+extern test_func test_alarm_hires;
+extern test_func test_palloc_latency;
+extern test_func test_slab_cache;
+extern test_func test_malloc_throughput;
+extern test_func test_palloc_zero;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
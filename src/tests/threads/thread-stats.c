@@ -0,0 +1,108 @@
+/* Checks the per-thread statistics reported by thread_stats().
+
+   The main thread spins, which must show up as kernel ticks,
+   and sleeps, which must count as voluntary context switches.
+   Then it holds a lock while a higher-priority thread waits for
+   it, which must show up as that thread's time blocked on locks,
+   and while that thread waits the main thread is ready but not
+   running, which must show up as its run-queue latency. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define HOLD_TICKS 5            /* Ticks to hold the lock. */
+#define MAX_THREAD_CNT 16       /* Max threads get_stats() looks at. */
+
+static thread_func waiter_thread;
+
+static struct lock lock;
+static struct thread_stats waiter_stats;
+
+static void get_stats (tid_t, struct thread_stats *);
+
+void
+test_thread_stats (void) 
+{
+  struct thread_stats before, after;
+  int64_t start;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  get_stats (thread_tid (), &before);
+  start = timer_ticks ();
+  while (timer_elapsed (start) < 10)
+    continue;
+  for (i = 0; i < 3; i++)
+    timer_sleep (1);
+  get_stats (thread_tid (), &after);
+
+  if (after.kernel_ticks - before.kernel_ticks >= 5)
+    msg ("Spinning counted as kernel ticks.");
+  else
+    msg ("Spinning only counted %lld kernel ticks.",
+         after.kernel_ticks - before.kernel_ticks);
+  if (after.voluntary_switches - before.voluntary_switches >= 3)
+    msg ("Sleeping counted as voluntary context switches.");
+  else
+    msg ("Sleeping only counted %lld voluntary context switches.",
+         after.voluntary_switches - before.voluntary_switches);
+
+  lock_init (&lock);
+  lock_acquire (&lock);
+  thread_create ("waiter", PRI_DEFAULT + 1, waiter_thread, NULL);
+  timer_sleep (HOLD_TICKS);
+  lock_release (&lock);
+
+  get_stats (thread_tid (), &before);
+  if (waiter_stats.lock_ticks >= HOLD_TICKS)
+    msg ("Waiter's time blocked on the lock was counted.");
+  else
+    msg ("Waiter was only blocked on the lock for %lld ticks.",
+         waiter_stats.lock_ticks);
+  if (before.ready_ticks - after.ready_ticks >= HOLD_TICKS)
+    msg ("Main thread's time in the run queue was counted.");
+  else
+    msg ("Main thread was only in the run queue for %lld ticks.",
+         before.ready_ticks - after.ready_ticks);
+}
+
+/* Waits for the lock, then spins for HOLD_TICKS holding it, so
+   that the main thread is ready but cannot run. */
+static void
+waiter_thread (void *aux UNUSED) 
+{
+  int64_t start;
+
+  lock_acquire (&lock);
+  start = timer_ticks ();
+  while (timer_elapsed (start) < HOLD_TICKS)
+    continue;
+  get_stats (thread_tid (), &waiter_stats);
+  lock_release (&lock);
+}
+
+/* Stores the statistics of the thread with the given TID in
+   *ST. */
+static void
+get_stats (tid_t tid, struct thread_stats *st) 
+{
+  static struct thread_stats stats[MAX_THREAD_CNT];
+  size_t cnt, i;
+
+  cnt = thread_stats (stats, MAX_THREAD_CNT);
+  if (cnt > MAX_THREAD_CNT)
+    cnt = MAX_THREAD_CNT;
+  for (i = 0; i < cnt; i++)
+    if (stats[i].tid == tid)
+      {
+        *st = stats[i];
+        return;
+      }
+  fail ("thread %d not found", tid);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-stats) begin
+(thread-stats) Spinning counted as kernel ticks.
+(thread-stats) Sleeping counted as voluntary context switches.
+(thread-stats) Waiter's time blocked on the lock was counted.
+(thread-stats) Main thread's time in the run queue was counted.
+(thread-stats) end
+EOF
+pass;
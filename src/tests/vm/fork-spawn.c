@@ -0,0 +1,69 @@
+/* Checks that a forked child's writes do not reach its parent,
+   then measures how long it takes to start a process that exits
+   right away, with fork() and with exec(). */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "fork-spawn";
+
+/* Processes started each way. */
+#define SPAWN_CNT 16
+
+/* Memory the parent has touched, shared with every child. */
+#define SIZE (256 * 1024)
+static char buf[SIZE];
+
+int
+main (int argc, char *argv[] UNUSED) 
+{
+  uint64_t start, fork_cycles, exec_cycles;
+  pid_t pid;
+  int i;
+
+  /* Started by exec() below: exit right away. */
+  if (argc > 1)
+    return 0;
+
+  msg ("begin");
+  memset (buf, 0x5a, sizeof buf);
+
+  pid = fork ();
+  if (pid == 0) 
+    {
+      memset (buf, 0xa5, sizeof buf);
+      exit (0x42);
+    }
+  CHECK (pid != PID_ERROR, "fork");
+  CHECK (wait (pid) == 0x42, "wait for child");
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != 0x5a)
+      fail ("byte %d changed by child", i);
+  msg ("parent's memory intact");
+
+  start = rdtsc ();
+  for (i = 0; i < SPAWN_CNT; i++) 
+    {
+      pid = fork ();
+      if (pid == 0)
+        exit (0);
+      if (pid == PID_ERROR || wait (pid) != 0)
+        fail ("fork %d", i);
+    }
+  fork_cycles = (rdtsc () - start) / SPAWN_CNT;
+
+  start = rdtsc ();
+  for (i = 0; i < SPAWN_CNT; i++) 
+    {
+      pid = exec ("fork-spawn child");
+      if (pid == PID_ERROR || wait (pid) != 0)
+        fail ("exec %d", i);
+    }
+  exec_cycles = (rdtsc () - start) / SPAWN_CNT;
+
+  msg ("Average spawn latency: fork %llu, exec %llu cycles.",
+       (unsigned long long) fork_cycles, (unsigned long long) exec_cycles);
+  msg ("end");
+  return 0;
+}
@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_lines (qr/parent's memory intact/,
+             qr/Average spawn latency: fork \d+, exec \d+ cycles\./);
@@ -0,0 +1,115 @@
+/* Reads the same file with read() and through a memory mapping,
+   checks that both see the same bytes, and measures how long
+   each takes. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Size of the file. */
+#define SIZE (128 * 1024)
+
+/* Times that the file is read each way. */
+#define PASS_CNT 4
+
+/* Where the file is mapped. */
+static const char *map_addr = (const char *) 0x10000000;
+
+/* Buffer for read(). */
+static char buf[4096];
+
+/* Returns the sum of the SIZE bytes at P. */
+static unsigned
+sum_bytes (const char *p, size_t size) 
+{
+  unsigned sum = 0;
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    sum += (unsigned char) p[i];
+  return sum;
+}
+
+/* Reads all of the file with read(), a page at a time, and
+   returns the sum of its bytes. */
+static unsigned
+read_pass (void) 
+{
+  unsigned sum = 0;
+  int handle;
+  size_t ofs;
+
+  handle = open ("big");
+  if (handle < 2)
+    fail ("open \"big\"");
+  for (ofs = 0; ofs < SIZE; ofs += sizeof buf) 
+    {
+      if (read (handle, buf, sizeof buf) != (int) sizeof buf)
+        fail ("read \"big\" at offset %zu", ofs);
+      sum += sum_bytes (buf, sizeof buf);
+    }
+  close (handle);
+  return sum;
+}
+
+/* Maps all of the file and returns the sum of its bytes. */
+static unsigned
+mmap_pass (void) 
+{
+  unsigned sum;
+  int handle;
+  mapid_t map;
+
+  handle = open ("big");
+  if (handle < 2)
+    fail ("open \"big\"");
+  map = mmap (handle, (void *) map_addr);
+  if (map == MAP_FAILED)
+    fail ("mmap \"big\"");
+  sum = sum_bytes (map_addr, SIZE);
+  munmap (map);
+  close (handle);
+  return sum;
+}
+
+void
+test_main (void)
+{
+  uint64_t read_cycles = 0, mmap_cycles = 0;
+  unsigned read_sum = 0, mmap_sum = 0;
+  int handle;
+  size_t ofs, i;
+  int pass;
+
+  CHECK (create ("big", SIZE), "create \"big\"");
+  CHECK ((handle = open ("big")) > 1, "open \"big\"");
+  for (ofs = 0; ofs < SIZE; ofs += sizeof buf) 
+    {
+      for (i = 0; i < sizeof buf; i++)
+        buf[i] = (ofs + i) * 7 % 251;
+      if (write (handle, buf, sizeof buf) != (int) sizeof buf)
+        fail ("write \"big\" at offset %zu", ofs);
+    }
+  close (handle);
+
+  for (pass = 0; pass < PASS_CNT; pass++) 
+    {
+      uint64_t start;
+
+      start = rdtsc ();
+      read_sum = read_pass ();
+      read_cycles += rdtsc () - start;
+
+      start = rdtsc ();
+      mmap_sum = mmap_pass ();
+      mmap_cycles += rdtsc () - start;
+
+      if (read_sum != mmap_sum)
+        fail ("read() sums to %u but mmap() to %u", read_sum, mmap_sum);
+    }
+  msg ("read() and mmap() agree");
+  msg ("Average time to read %d kB: read %llu, mmap %llu cycles.",
+       SIZE / 1024, (unsigned long long) (read_cycles / PASS_CNT),
+       (unsigned long long) (mmap_cycles / PASS_CNT));
+}
@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_lines (qr/read\(\) and mmap\(\) agree/,
+             qr/Average time to read \d+ kB: read \d+, mmap \d+ cycles\./);
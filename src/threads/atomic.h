@@ -0,0 +1,38 @@
+#ifndef THREADS_ATOMIC_H
+#define THREADS_ATOMIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Atomically compares the 32-bit word at P with OLD and, if they
+   are equal, replaces it by NEW.  Returns true if the word was
+   replaced.  Acts as a full memory and compiler barrier. */
+static inline bool
+atomic_cas (volatile uint32_t *p, uint32_t old, uint32_t new)
+{
+  /* See [IA32-v2a] "CMPXCHG". */
+  uint8_t success;
+  asm volatile ("lock cmpxchgl %3, %1; sete %0"
+                : "=q" (success), "+m" (*p), "+a" (old)
+                : "r" (new)
+                : "memory", "cc");
+  return success;
+}
+
+/* Like atomic_cas(), for the pointer at P. */
+static inline bool
+atomic_cas_ptr (void *volatile *p, void *old, void *new)
+{
+  return atomic_cas ((volatile uint32_t *) p,
+                     (uint32_t) old, (uint32_t) new);
+}
+
+/* Tells the CPU that we are in a spin-wait loop. */
+static inline void
+cpu_relax (void)
+{
+  /* See [IA32-v2b] "PAUSE". */
+  asm volatile ("pause" : : : "memory");
+}
+
+#endif /* threads/atomic.h */
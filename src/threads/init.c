@@ -20,7 +20,9 @@
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/pte.h"
+#include "threads/trace.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -37,6 +39,9 @@
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
@@ -97,6 +102,7 @@ main (void)
   /* Initialize memory system. */
   palloc_init (user_page_limit);
   malloc_init ();
+  trace_init ();
   paging_init ();
 
   /* Segmentation. */
@@ -119,6 +125,7 @@ main (void)
   thread_start ();
   serial_init_queue ();
   timer_calibrate ();
+  profile_init ();
 
 #ifdef FILESYS
   /* Initialize file system. */
@@ -126,6 +133,9 @@ main (void)
   locate_block_devices ();
   filesys_init (format_filesys);
 #endif
+#ifdef VM
+  page_init ();
+#endif
 
   printf ("Boot complete.\n");
   
@@ -256,6 +266,20 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-sched"))
+        {
+          if (value != NULL && !strcmp (value, "mlfqs"))
+            thread_mlfqs = true;
+          else if (value != NULL && !strcmp (value, "cfs"))
+            thread_cfs = true;
+          else if (value == NULL || strcmp (value, "rr"))
+            PANIC ("unknown scheduler `%s' (use -h for help)",
+                   value != NULL ? value : "");
+        }
+      else if (!strcmp (name, "-trace"))
+        trace_enabled = true;
+      else if (!strcmp (name, "-profile"))
+        profile_hz = value != NULL ? atoi (value) : 0;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -263,6 +287,9 @@ parse_options (char **argv)
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
     }
+  if (thread_mlfqs && thread_cfs)
+    PANIC ("cannot use both the mlfqs and cfs schedulers "
+           "(use -h for help)");
 
   /* Initialize the random number generator based on the system
      time.  This has no effect if an "-rs" option was specified.
@@ -292,6 +319,47 @@ run_task (char **argv)
   printf ("Execution of '%s' complete.\n", task);
 }
 
+/* Lists every thread with its statistics. */
+static void
+run_ps (char **argv UNUSED)
+{
+  struct thread_stats *stats;
+  size_t cnt, i;
+
+  /* Leave room for threads created in the meantime. */
+  cnt = thread_stats (NULL, 0) + 8;
+  stats = malloc (cnt * sizeof *stats);
+  if (stats == NULL)
+    PANIC ("ps: out of memory");
+  cnt = thread_stats (stats, cnt);
+
+  printf ("%5s %-15s %-7s %4s %4s %7s %7s %7s %7s %7s %7s\n",
+          "TID", "NAME", "STATE", "PRI", "NICE", "USER", "KERNEL",
+          "VCSW", "IVCSW", "READY", "LOCK");
+  for (i = 0; i < cnt; i++)
+    {
+      struct thread_stats *st = &stats[i];
+      printf ("%5d %-15s %-7s %4d %4d %7lld %7lld %7lld %7lld %7lld %7lld\n",
+              st->tid, st->name, thread_status_name (st->status),
+              st->priority, st->nice, st->user_ticks, st->kernel_ticks,
+              st->voluntary_switches, st->involuntary_switches,
+              st->ready_ticks, st->lock_ticks);
+    }
+  free (stats);
+}
+
+#ifdef FILESYS
+/* Writes the event trace to the scratch device. */
+static void
+run_trace_dump (char **argv UNUSED)
+{
+  struct block *scratch = block_get_role (BLOCK_SCRATCH);
+  if (scratch == NULL)
+    PANIC ("couldn't open scratch device");
+  trace_dump (scratch);
+}
+#endif
+
 /* Executes all of the actions specified in ARGV[]
    up to the null pointer sentinel. */
 static void
@@ -309,12 +377,14 @@ run_actions (char **argv)
   static const struct action actions[] = 
     {
       {"run", 2, run_task},
+      {"ps", 1, run_ps},
 #ifdef FILESYS
       {"ls", 1, fsutil_ls},
       {"cat", 2, fsutil_cat},
       {"rm", 2, fsutil_rm},
       {"extract", 1, fsutil_extract},
       {"append", 2, fsutil_append},
+      {"trace-dump", 1, run_trace_dump},
 #endif
       {NULL, 0, NULL},
     };
@@ -357,6 +427,7 @@ usage (void)
 #else
           "  run TEST           Run TEST.\n"
 #endif
+          "  ps                 List threads and their statistics.\n"
 #ifdef FILESYS
           "  ls                 List files in the root directory.\n"
           "  cat FILE           Print FILE to the console.\n"
@@ -364,6 +435,7 @@ usage (void)
           "Use these actions indirectly via `pintos' -g and -p options:\n"
           "  extract            Untar from scratch device into file system.\n"
           "  append FILE        Append FILE to tar file on scratch device.\n"
+          "  trace-dump         Write recorded kernel events to scratch device.\n"
 #endif
           "\nOptions:\n"
           "  -h                 Print this help message and power off.\n"
@@ -379,6 +451,9 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -sched=SCHED       Use scheduler SCHED: rr (default), mlfqs, or cfs.\n"
+          "  -profile=HZ        Sample kernel stacks about HZ times per second.\n"
+          "  -trace             Record kernel events for trace-dump.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -7,6 +7,7 @@
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "devices/timer.h"
 
@@ -362,6 +363,7 @@ intr_handler (struct intr_frame *frame)
     }
 
   /* Invoke the interrupt's handler. */
+  trace (TRACE_INTR_ENTER, frame->vec_no, (uintptr_t) frame->eip);
   handler = intr_handlers[frame->vec_no];
   if (handler != NULL)
     handler (frame);
@@ -373,6 +375,7 @@ intr_handler (struct intr_frame *frame)
     }
   else
     unexpected_interrupt (frame);
+  trace (TRACE_INTR_EXIT, frame->vec_no, 0);
 
   /* Complete the processing of an external interrupt. */
   if (external) 
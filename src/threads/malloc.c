@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -32,7 +33,26 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   In front of the descriptors sits a layer of "magazines", after
+   Bonwick and Adams, "Magazines and Vmem", USENIX 2001.  Each
+   descriptor has a magazine that holds up to MAG_ROUNDS recently
+   freed blocks.  malloc() and free() take from and add to the
+   magazine with interrupts briefly disabled, without locking the
+   descriptor.
+   Only when the magazine is empty or full do they lock the
+   descriptor, and then move MAG_ROUNDS / 2 blocks at once, so
+   that alternating allocations and frees cannot make every call
+   go to the descriptor.  For the same reason, a descriptor keeps
+   up to DESC_SPARE_MAX arenas with no blocks in use instead of
+   handing them straight back to the page allocator. */
+
+/* Blocks per magazine. */
+#define MAG_ROUNDS 16
+
+/* Unused arenas a descriptor keeps. */
+#define DESC_SPARE_MAX 1
 
 /* Descriptor. */
 struct desc
@@ -40,7 +60,9 @@ struct desc
     size_t block_size;          /* Size of each element in bytes. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
     struct list free_list;      /* List of free blocks. */
+    size_t spare_cnt;           /* Arenas with every block free. */
     struct lock lock;           /* Lock. */
+    char name[16];              /* Lock name, e.g. "malloc 16". */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -61,11 +83,27 @@ struct block
   };
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
-static size_t desc_cnt;         /* Number of descriptors. */
+#define DESC_MAX 10
+static struct desc descs[DESC_MAX];     /* Descriptors. */
+static size_t desc_cnt;                 /* Number of descriptors. */
+
+/* A magazine of free blocks for one descriptor. */
+struct magazine
+  {
+    size_t cnt;                         /* Number of blocks. */
+    struct block *rounds[MAG_ROUNDS];   /* The blocks. */
+  };
+
+/* Magazines, by descriptor.  Only touched with interrupts
+   off. */
+static struct magazine magazines[DESC_MAX];
 
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static struct block *mag_pop (struct desc *);
+static bool mag_push (struct desc *, struct block *);
+static struct block *desc_get (struct desc *);
+static void desc_put (struct desc *, struct block *);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -80,7 +118,10 @@ malloc_init (void)
       d->block_size = block_size;
       d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
       list_init (&d->free_list);
+      d->spare_cnt = 0;
       lock_init (&d->lock);
+      snprintf (d->name, sizeof d->name, "malloc %zu", block_size);
+      lock_set_name (&d->lock, d->name);
     }
 }
 
@@ -92,6 +133,7 @@ malloc (size_t size)
   struct desc *d;
   struct block *b;
   struct arena *a;
+  int i;
 
   /* A null pointer satisfies a request for 0 bytes. */
   if (size == 0)
@@ -119,36 +161,29 @@ malloc (size_t size)
       return a + 1;
     }
 
-  lock_acquire (&d->lock);
+  /* Try the magazine first. */
+  b = mag_pop (d);
+  if (b != NULL)
+    return b;
 
-  /* If the free list is empty, create a new arena. */
-  if (list_empty (&d->free_list))
+  /* The magazine is empty.  Get a block from the descriptor, and
+     half a magazine more while we hold its lock, but only from
+     arenas that already exist. */
+  lock_acquire (&d->lock);
+  b = desc_get (d);
+  for (i = 0; b != NULL && i < MAG_ROUNDS / 2; i++) 
     {
-      size_t i;
-
-      /* Allocate a page. */
-      a = palloc_get_page (0);
-      if (a == NULL) 
-        {
-          lock_release (&d->lock);
-          return NULL; 
-        }
+      struct block *extra;
 
-      /* Initialize arena and add its blocks to the free list. */
-      a->magic = ARENA_MAGIC;
-      a->desc = d;
-      a->free_cnt = d->blocks_per_arena;
-      for (i = 0; i < d->blocks_per_arena; i++) 
+      if (list_empty (&d->free_list))
+        break;
+      extra = desc_get (d);
+      if (!mag_push (d, extra)) 
         {
-          struct block *b = arena_to_block (a, i);
-          list_push_back (&d->free_list, &b->free_elem);
+          desc_put (d, extra);
+          break;
         }
     }
-
-  /* Get a block from free list and return it. */
-  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-  a = block_to_arena (b);
-  a->free_cnt--;
   lock_release (&d->lock);
   return b;
 }
@@ -228,30 +263,27 @@ free (void *p)
         {
           /* It's a normal block.  We handle it here. */
 
+          int i;
+
 #ifndef NDEBUG
           /* Clear the block to help detect use-after-free bugs. */
           memset (b, 0xcc, d->block_size);
 #endif
-  
-          lock_acquire (&d->lock);
 
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
+          if (mag_push (d, b))
+            return;
 
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena) 
+          /* The magazine is full.  Give B and half of the
+             magazine back to the descriptor. */
+          lock_acquire (&d->lock);
+          desc_put (d, b);
+          for (i = 0; i < MAG_ROUNDS / 2; i++) 
             {
-              size_t i;
-
-              ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++) 
-                {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
-                }
-              palloc_free_page (a);
+              b = mag_pop (d);
+              if (b == NULL)
+                break;
+              desc_put (d, b);
             }
-
           lock_release (&d->lock);
         }
       else
@@ -263,6 +295,107 @@ free (void *p)
     }
 }
 
+/* Takes a block from D's magazine and returns it, or returns a
+   null pointer if the magazine is empty. */
+static struct block *
+mag_pop (struct desc *d) 
+{
+  enum intr_level old_level = intr_disable ();
+  struct magazine *m = &magazines[d - descs];
+  struct block *b = m->cnt > 0 ? m->rounds[--m->cnt] : NULL;
+  intr_set_level (old_level);
+
+  return b;
+}
+
+/* Adds B to D's magazine and returns true, or returns false if
+   the magazine is full. */
+static bool
+mag_push (struct desc *d, struct block *b) 
+{
+  enum intr_level old_level = intr_disable ();
+  struct magazine *m = &magazines[d - descs];
+  bool success = m->cnt < MAG_ROUNDS;
+  if (success)
+    m->rounds[m->cnt++] = b;
+  intr_set_level (old_level);
+
+  return success;
+}
+
+/* Takes a block from D's free list, creating a new arena if the
+   list is empty, and returns it.  Returns a null pointer if
+   memory is not available.  D's lock must be held. */
+static struct block *
+desc_get (struct desc *d) 
+{
+  struct block *b;
+  struct arena *a;
+
+  ASSERT (lock_held_by_current_thread (&d->lock));
+
+  /* If the free list is empty, create a new arena. */
+  if (list_empty (&d->free_list))
+    {
+      size_t i;
+
+      /* Allocate a page. */
+      a = palloc_get_page (0);
+      if (a == NULL) 
+        return NULL; 
+
+      /* Initialize arena and add its blocks to the free list. */
+      a->magic = ARENA_MAGIC;
+      a->desc = d;
+      a->free_cnt = d->blocks_per_arena;
+      d->spare_cnt++;
+      for (i = 0; i < d->blocks_per_arena; i++) 
+        {
+          struct block *b = arena_to_block (a, i);
+          list_push_back (&d->free_list, &b->free_elem);
+        }
+    }
+
+  /* Get a block from free list. */
+  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
+  a = block_to_arena (b);
+  if (a->free_cnt-- == d->blocks_per_arena)
+    d->spare_cnt--;
+  return b;
+}
+
+/* Returns block B to D's free list.  D's lock must be held. */
+static void
+desc_put (struct desc *d, struct block *b) 
+{
+  struct arena *a = block_to_arena (b);
+
+  ASSERT (lock_held_by_current_thread (&d->lock));
+
+  /* Add block to free list. */
+  list_push_front (&d->free_list, &b->free_elem);
+
+  /* If the arena is now entirely unused, keep it as a spare or,
+     if we have enough of those, free it. */
+  if (++a->free_cnt >= d->blocks_per_arena) 
+    {
+      size_t i;
+
+      ASSERT (a->free_cnt == d->blocks_per_arena);
+      if (d->spare_cnt < DESC_SPARE_MAX) 
+        {
+          d->spare_cnt++;
+          return;
+        }
+      for (i = 0; i < d->blocks_per_arena; i++) 
+        {
+          struct block *b = arena_to_block (a, i);
+          list_remove (&b->free_elem);
+        }
+      palloc_free_page (a);
+    }
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
@@ -2,14 +2,17 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 
 /* Page allocator.  Hands out memory in page-size (or
    page-multiple) chunks.  See malloc.h for an allocator that
@@ -23,7 +26,34 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is managed by a binary buddy allocator.  A pool's
+   free pages are grouped into blocks of 2**ORDER pages that
+   start at a multiple of 2**ORDER pages from the pool's base,
+   with one free list per order.  An allocation takes a block of
+   the smallest sufficient order, splitting a larger one if
+   necessary, and a freed block is merged with its "buddy", the
+   other half of the block of the next order up, whenever that is
+   free too.  Both take O(PALLOC_MAX_ORDER) time, rather than a
+   scan over the whole pool.
+
+   Allocations need not be a power of 2 in size: the pages left
+   over at the end of the block are freed again at once, and
+   palloc_free_multiple() frees any aligned run of pages.
+
+   The idle thread keeps a few pages of each pool zeroed ahead of
+   time, so that a PAL_ZERO request for a single page can usually
+   skip the memset().  These pages count as allocated until they
+   are handed out, but they are given back to the buddy allocator
+   if an allocation would otherwise fail. */
+
+/* Largest block order: blocks of up to 2**PALLOC_MAX_ORDER pages
+   (4 MB), which also bounds the size of an allocation. */
+#define PALLOC_MAX_ORDER 10
+
+/* Maximum number of pre-zeroed pages kept per pool. */
+#define PALLOC_ZEROED_MAX 32
 
 /* A memory pool. */
 struct pool
@@ -31,6 +61,41 @@ struct pool
     struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
     uint8_t *base;                      /* Base of pool. */
+    size_t page_cnt;                    /* Number of pages in pool. */
+
+    /* Buddy allocator.  Each free block is in the free list for
+       its order, linked through a struct free_block in its
+       first page, and order_map[] holds ORDER + 1 for the first
+       page of a free block of that order, 0 for any other
+       page. */
+    struct list free_lists[PALLOC_MAX_ORDER + 1];
+    uint8_t *order_map;
+
+    /* Pages zeroed by the idle thread.  An array rather than a
+       list, so that keeping track of them does not write to
+       them. */
+    void *zeroed[PALLOC_ZEROED_MAX];
+    size_t zeroed_cnt;
+
+    /* A page the idle thread zeroed but found the lock taken
+       when it came to add the page to zeroed[].  The idle thread
+       adds it next time, unless an allocation that would fail
+       reclaims it first.  Accessed only with interrupts off. */
+    void *idle_page;
+    uint64_t idle_page_cycles;
+
+    /* Statistics. */
+    const char *name;                   /* Pool name. */
+    unsigned long long zero_hits;       /* PAL_ZERO pages pre-zeroed. */
+    unsigned long long zero_misses;     /* PAL_ZERO pages memset(). */
+    unsigned long long idle_zeroed;     /* Pages zeroed while idle. */
+    uint64_t idle_cycles;               /* TSC cycles spent on those. */
+  };
+
+/* Start of a free block. */
+struct free_block
+  {
+    struct list_elem elem;              /* Element in a free list. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -39,6 +104,10 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t alloc_pages (struct pool *, size_t page_cnt);
+static void free_pages (struct pool *, size_t page_idx, size_t page_cnt);
+static bool release_zeroed (struct pool *);
+static void free_zeroed (struct pool *, void *page);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -78,7 +147,27 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
     return NULL;
 
   lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+  if (page_cnt == 1 && (flags & PAL_ZERO) && pool->zeroed_cnt > 0)
+    {
+      pages = pool->zeroed[--pool->zeroed_cnt];
+      pool->zero_hits++;
+      lock_release (&pool->lock);
+      return pages;
+    }
+
+  page_idx = alloc_pages (pool, page_cnt);
+  if (page_idx == BITMAP_ERROR && release_zeroed (pool))
+    {
+      /* Out of memory: the pre-zeroed pages are a luxury. */
+      page_idx = alloc_pages (pool, page_cnt);
+    }
+  if (page_idx != BITMAP_ERROR)
+    {
+      ASSERT (bitmap_none (pool->used_map, page_idx, page_cnt));
+      bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+      if (page_cnt == 1 && (flags & PAL_ZERO))
+        pool->zero_misses++;
+    }
   lock_release (&pool->lock);
 
   if (page_idx != BITMAP_ERROR)
@@ -137,8 +226,11 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
+  lock_acquire (&pool->lock);
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  free_pages (pool, page_idx, page_cnt);
+  lock_release (&pool->lock);
 }
 
 /* Frees the page at PAGE. */
@@ -148,25 +240,270 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Zeroes one free page of POOL and adds it to POOL's pre-zeroed
+   pages.  Returns true if it did, false if POOL already has
+   enough zeroed pages, is out of free pages, or its lock is
+   taken.
+
+   Must be called with interrupts off, but turns them on while
+   zeroing the page. */
+static bool
+zero_page (struct pool *pool) 
+{
+  void *page = pool->idle_page;
+  size_t page_idx = BITMAP_ERROR;
+  uint64_t start;
+
+  /* The idle thread must not block, so if some thread holds the
+     lock, there is nothing to do now; the idle thread halts and
+     tries again later. */
+  pool->idle_page = NULL;
+  if (page == NULL)
+    {
+      if (!lock_try_acquire (&pool->lock))
+        return false;
+      if (pool->zeroed_cnt < PALLOC_ZEROED_MAX)
+        {
+          page_idx = alloc_pages (pool, 1);
+          if (page_idx != BITMAP_ERROR)
+            bitmap_mark (pool->used_map, page_idx);
+        }
+      lock_release (&pool->lock);
+      if (page_idx == BITMAP_ERROR)
+        return false;
+      page = pool->base + page_idx * PGSIZE;
+
+      /* Let interrupts in while zeroing, so that a thread that
+         becomes ready preempts us. */
+      intr_enable ();
+      start = timer_rdtsc ();
+      memset (page, 0, PGSIZE);
+      pool->idle_page_cycles = timer_rdtsc () - start;
+      intr_disable ();
+    }
+
+  /* Other threads may have run meanwhile, taken the lock, or
+     filled up the array.  If the lock is taken, leave the page
+     in idle_page, where release_zeroed() can find it. */
+  if (!lock_try_acquire (&pool->lock))
+    {
+      pool->idle_page = page;
+      return false;
+    }
+  if (pool->zeroed_cnt < PALLOC_ZEROED_MAX)
+    {
+      pool->zeroed[pool->zeroed_cnt++] = page;
+      pool->idle_zeroed++;
+      pool->idle_cycles += pool->idle_page_cycles;
+    }
+  else
+    free_zeroed (pool, page);
+  lock_release (&pool->lock);
+  return true;
+}
+
+/* Called by the idle thread, with interrupts off, when there is
+   nothing else to do.  Zeroes a free page ahead of a future
+   PAL_ZERO request and returns true, or returns false if there
+   is nothing to be done. */
+bool
+palloc_zero_idle (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  return zero_page (&kernel_pool) || zero_page (&user_pool);
+}
+
+/* Returns POOL's pre-zeroed pages, including any left in
+   idle_page, to its free blocks.  Returns true if there were
+   any, false otherwise.  POOL's lock must be held. */
+static bool
+release_zeroed (struct pool *pool) 
+{
+  enum intr_level old_level;
+  void *idle_page;
+  bool released = pool->zeroed_cnt > 0;
+
+  ASSERT (lock_held_by_current_thread (&pool->lock));
+
+  while (pool->zeroed_cnt > 0)
+    free_zeroed (pool, pool->zeroed[--pool->zeroed_cnt]);
+
+  old_level = intr_disable ();
+  idle_page = pool->idle_page;
+  pool->idle_page = NULL;
+  intr_set_level (old_level);
+  if (idle_page != NULL)
+    {
+      free_zeroed (pool, idle_page);
+      released = true;
+    }
+  return released;
+}
+
+/* Returns PAGE, a page of POOL marked used in its used_map but
+   not handed out, to POOL's free blocks.  POOL's lock must be
+   held. */
+static void
+free_zeroed (struct pool *pool, void *page) 
+{
+  size_t page_idx = pg_no (page) - pg_no (pool->base);
+
+  bitmap_reset (pool->used_map, page_idx);
+  free_pages (pool, page_idx, 1);
+}
+
+/* Prints the pre-zeroed page statistics for POOL. */
+static void
+print_pool_stats (const struct pool *pool) 
+{
+  unsigned long long saved = 0;
+
+  if (pool->idle_zeroed > 0)
+    saved = pool->idle_cycles / pool->idle_zeroed * pool->zero_hits;
+  printf ("  %-12s %6llu %6llu %6llu %5zu %12llu\n",
+          pool->name, pool->idle_zeroed, pool->zero_hits,
+          pool->zero_misses, pool->zeroed_cnt, saved);
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void) 
+{
+  printf ("Pre-zeroed pages (zeroed while idle, hits, misses, "
+          "on hand, memset cycles saved):\n");
+  print_pool_stats (&kernel_pool);
+  print_pool_stats (&user_pool);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
+  /* We'll put the pool's used_map and order_map at its base.
+     Calculate the space needed for them and subtract it from
+     the pool's size.  This sizes them for slightly more pages
+     than remain, which is harmless. */
+  size_t bm_size = ROUND_UP (bitmap_buf_size (page_cnt), sizeof (long));
+  size_t meta_pages = DIV_ROUND_UP (bm_size + page_cnt, PGSIZE);
+  int order;
+
+  if (meta_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  page_cnt -= meta_pages;
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
   lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  lock_set_name (&p->lock, name);
+  p->name = name;
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
+  p->order_map = (uint8_t *) base + bm_size;
+  memset (p->order_map, 0, page_cnt);
+  p->base = (uint8_t *) base + meta_pages * PGSIZE;
+  p->page_cnt = page_cnt;
+  for (order = 0; order <= PALLOC_MAX_ORDER; order++)
+    list_init (&p->free_lists[order]);
+  free_pages (p, 0, page_cnt);
+}
+
+/* Returns the first page of block PAGE_IDX in POOL as a free
+   block. */
+static struct free_block *
+idx_to_block (const struct pool *pool, size_t page_idx) 
+{
+  return (struct free_block *) (pool->base + page_idx * PGSIZE);
+}
+
+/* Adds the block of 2**ORDER pages at PAGE_IDX to POOL's free
+   lists, first merging it with its buddy and then with the
+   buddy of the resulting block, and so on, for as long as those
+   are free. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order) 
+{
+  while (order < PALLOC_MAX_ORDER) 
+    {
+      size_t buddy_idx = page_idx ^ ((size_t) 1 << order);
+      if (buddy_idx >= pool->page_cnt
+          || pool->order_map[buddy_idx] != order + 1)
+        break;
+
+      /* Buddy is free: take it off its list and merge. */
+      list_remove (&idx_to_block (pool, buddy_idx)->elem);
+      pool->order_map[buddy_idx] = 0;
+      if (buddy_idx < page_idx)
+        page_idx = buddy_idx;
+      order++;
+    }
+
+  pool->order_map[page_idx] = order + 1;
+  list_push_front (&pool->free_lists[order],
+                   &idx_to_block (pool, page_idx)->elem);
+}
+
+/* Frees the PAGE_CNT pages at PAGE_IDX in POOL, which need not
+   be a block, by breaking them into the largest aligned
+   blocks. */
+static void
+free_pages (struct pool *pool, size_t page_idx, size_t page_cnt) 
+{
+  while (page_cnt > 0) 
+    {
+      int order = 0;
+      size_t size;
+
+      while (order < PALLOC_MAX_ORDER
+             && (page_idx & (((size_t) 2 << order) - 1)) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+      size = (size_t) 1 << order;
+
+      free_block (pool, page_idx, order);
+      page_idx += size;
+      page_cnt -= size;
+    }
+}
+
+/* Takes PAGE_CNT contiguous pages from POOL's free blocks and
+   returns the index of the first, or BITMAP_ERROR if there is no
+   large enough block. */
+static size_t
+alloc_pages (struct pool *pool, size_t page_cnt) 
+{
+  struct free_block *b;
+  size_t page_idx;
+  int order, k;
+
+  /* Find the smallest order that holds PAGE_CNT pages... */
+  for (order = 0; ((size_t) 1 << order) < page_cnt; order++)
+    if (order == PALLOC_MAX_ORDER)
+      return BITMAP_ERROR;
+
+  /* ...and the smallest free block at least that large. */
+  for (k = order; list_empty (&pool->free_lists[k]); k++)
+    if (k == PALLOC_MAX_ORDER)
+      return BITMAP_ERROR;
+
+  b = list_entry (list_pop_front (&pool->free_lists[k]),
+                  struct free_block, elem);
+  page_idx = pg_no (b) - pg_no (pool->base);
+  pool->order_map[page_idx] = 0;
+
+  /* Split off and free the upper halves not needed. */
+  while (k > order) 
+    {
+      k--;
+      free_block (pool, page_idx + ((size_t) 1 << k), k);
+    }
+
+  /* Give back the pages at the end that we don't need. */
+  if (page_cnt < (size_t) 1 << order)
+    free_pages (pool, page_idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+
+  return page_idx;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -176,7 +513,7 @@ page_from_pool (const struct pool *pool, void *page)
 {
   size_t page_no = pg_no (page);
   size_t start_page = pg_no (pool->base);
-  size_t end_page = start_page + bitmap_size (pool->used_map);
+  size_t end_page = start_page + pool->page_cnt;
 
   return page_no >= start_page && page_no < end_page;
 }
@@ -0,0 +1,139 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "devices/rtc.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* One sample: the interrupted instruction in pc[0], then the
+   return addresses of the frames below it.  Unused slots are
+   0. */
+struct sample
+  {
+    uintptr_t pc[PROFILE_DEPTH];
+  };
+
+/* Pages in the ring buffer.  Must yield a power of 2 samples. */
+#define RING_PAGES 16
+#define RING_SIZE (RING_PAGES * PGSIZE / sizeof (struct sample))
+
+/* Ring of samples.  It is only written from the profiling
+   interrupt, so it needs no lock.  Once it fills up, new samples
+   overwrite the oldest ones, so at shutdown it holds the most
+   recent RING_SIZE samples. */
+static struct sample *samples;          /* RING_SIZE samples. */
+static unsigned long long sample_cnt;   /* Total # of samples taken. */
+
+/* -profile=HZ: Sampling rate, or 0 if profiling is off. */
+int profile_hz;
+
+static intr_handler_func profile_interrupt;
+static int sample_compare (const void *, const void *);
+
+/* Allocates the sample buffer and starts sampling, if
+   profiling was requested on the command line.  Nothing is
+   allocated from the profiling interrupt itself. */
+void
+profile_init (void)
+{
+  ASSERT ((RING_SIZE & (RING_SIZE - 1)) == 0);
+
+  if (profile_hz <= 0)
+    return;
+
+  samples = palloc_get_multiple (PAL_ASSERT | PAL_ZERO, RING_PAGES);
+  profile_hz = rtc_start_periodic (profile_hz, profile_interrupt);
+  printf ("Profiling at %d Hz.\n", profile_hz);
+}
+
+/* Profiling interrupt handler.  Records where F was interrupted.
+
+   Code that runs with interrupts disabled cannot be sampled;
+   its samples are charged to wherever interrupts are next
+   enabled. */
+static void
+profile_interrupt (struct intr_frame *f)
+{
+  struct sample *s = &samples[sample_cnt++ & (RING_SIZE - 1)];
+  int depth = 0;
+
+  s->pc[depth++] = (uintptr_t) f->eip;
+
+  /* Walk the kernel stack by frame pointers.  Every frame must
+     lie above the previous one and within the page that holds
+     the interrupt frame, which is the interrupted thread's
+     kernel stack, so a corrupt or missing frame pointer ends the
+     walk instead of faulting.  User stacks are not walked. */
+  if (f->cs == SEL_KCSEG)
+    {
+      uintptr_t stack_top = (uintptr_t) pg_round_down (f) + PGSIZE;
+      uint32_t *frame = (uint32_t *) f->ebp;
+
+      while (depth < PROFILE_DEPTH
+             && (uintptr_t) frame > (uintptr_t) f
+             && (uintptr_t) (frame + 2) <= stack_top
+             && frame[1] != 0)
+        {
+          uint32_t *next = (uint32_t *) frame[0];
+          s->pc[depth++] = frame[1];
+          if (next <= frame)
+            break;
+          frame = next;
+        }
+    }
+
+  while (depth < PROFILE_DEPTH)
+    s->pc[depth++] = 0;
+}
+
+/* Prints the samples, merging identical ones.  Each line has a
+   count followed by the sample's addresses, innermost first.
+   Sorts the ring in place, so profiling must be over. */
+void
+profile_print (void)
+{
+  size_t n, i, run;
+
+  if (profile_hz <= 0)
+    return;
+
+  intr_disable ();
+  n = sample_cnt < RING_SIZE ? sample_cnt : RING_SIZE;
+  printf ("Profile: %llu samples at %d Hz, %llu lost.\n",
+          sample_cnt, profile_hz, sample_cnt - n);
+
+  qsort (samples, n, sizeof *samples, sample_compare);
+  for (i = 0; i < n; i += run)
+    {
+      int d;
+
+      for (run = 1; i + run < n; run++)
+        if (sample_compare (&samples[i], &samples[i + run]))
+          break;
+
+      printf ("Profile sample: %zu", run);
+      for (d = 0; d < PROFILE_DEPTH && samples[i].pc[d] != 0; d++)
+        printf (" %#"PRIxPTR, samples[i].pc[d]);
+      printf ("\n");
+    }
+}
+
+/* Orders samples A and B lexicographically by address. */
+static int
+sample_compare (const void *a_, const void *b_)
+{
+  const struct sample *a = a_;
+  const struct sample *b = b_;
+  int d;
+
+  for (d = 0; d < PROFILE_DEPTH; d++)
+    if (a->pc[d] != b->pc[d])
+      return a->pc[d] < b->pc[d] ? -1 : 1;
+  return 0;
+}
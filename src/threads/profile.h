@@ -0,0 +1,24 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+/* Sampling profiler.
+
+   When enabled with -profile=HZ, the real-time clock interrupts
+   the kernel about HZ times per second, independent of the timer
+   tick, and each interrupt records the interrupted instruction
+   pointer and a short frame-pointer backtrace.  At shutdown the
+   samples are merged and printed as "Profile sample:" lines,
+   which utils/backtrace turns into flat and call-graph
+   reports. */
+
+/* Most return addresses recorded per sample, including the
+   interrupted instruction. */
+#define PROFILE_DEPTH 8
+
+/* -profile=HZ: Sampling rate, or 0 if profiling is off. */
+extern int profile_hz;
+
+void profile_init (void);
+void profile_print (void);
+
+#endif /* threads/profile.h */
@@ -0,0 +1,313 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A slab allocator, after Bonwick, "The Slab Allocator: An
+   Object-Caching Kernel Memory Allocator", USENIX 1994.
+
+   Each slab is one page from the page allocator.  It begins with
+   a struct slab, whose free[] array is a stack of the indexes of
+   the slab's free objects, followed by the objects themselves.
+   Keeping the free list outside the objects leaves them in their
+   constructed state while they are free.  A slab is found from
+   any of its objects by rounding down to the page boundary.
+
+   A cache keeps its slabs on three lists, according to whether
+   some, all, or none of their objects are allocated, and
+   allocates from partially full slabs first so that the others
+   can empty out.  It holds on to at most SLAB_EMPTY_MAX empty
+   slabs and gives any more back to the page allocator.
+
+   The space left over at the end of a slab is used to "color"
+   it: successive slabs start their objects at different offsets,
+   a multiple of SLAB_COLOR_STEP bytes apart, so that objects at
+   the same index in different slabs do not all compete for the
+   same cache lines. */
+
+/* Empty slabs a cache keeps for reuse. */
+#define SLAB_EMPTY_MAX 1
+
+/* Distance between slab colors, in bytes, at least. */
+#define SLAB_COLOR_STEP 32
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* A cache. */
+struct kmem_cache
+  {
+    const char *name;           /* Name (for statistics). */
+    size_t size;                /* Object size, as requested. */
+    size_t stride;              /* Distance between objects. */
+    size_t align;               /* Object alignment. */
+    kmem_ctor_func *ctor;       /* Constructor, or null. */
+
+    struct lock lock;           /* Protects everything below. */
+    struct list partial;        /* Slabs with some objects free. */
+    struct list full;           /* Slabs with no objects free. */
+    struct list empty;          /* Slabs with all objects free. */
+    size_t empty_cnt;           /* Number of slabs in `empty'. */
+
+    size_t obj_cnt;             /* Objects per slab. */
+    size_t obj_ofs;             /* Offset of first object, uncolored. */
+    size_t color_step;          /* Bytes between colors. */
+    size_t color_cnt;           /* Number of colors. */
+    size_t color_next;          /* Color of next slab created. */
+
+    /* Statistics. */
+    unsigned long long alloc_cnt;       /* # of objects allocated. */
+    unsigned long long free_cnt;        /* # of objects freed. */
+    unsigned long long grow_cnt;        /* # of slabs created. */
+    unsigned long long reap_cnt;        /* # of slabs given back. */
+    size_t slab_cnt;                    /* Slabs in the cache now. */
+    size_t in_use;                      /* Objects allocated now. */
+
+    struct list_elem elem;      /* Element in `caches'. */
+  };
+
+/* Slab header, at the start of the slab's page. */
+struct slab
+  {
+    struct list_elem elem;      /* Element in one of the cache's lists. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    unsigned magic;             /* Detects corruption. */
+    uint8_t *objs;              /* First object. */
+    size_t free_cnt;            /* Number of free objects. */
+    uint16_t free[];            /* Indexes of free objects. */
+  };
+
+/* All caches, for kmem_print_stats(). */
+static struct list caches = LIST_INITIALIZER (caches);
+
+static struct slab *slab_create (struct kmem_cache *);
+static void slab_destroy (struct kmem_cache *, struct slab *);
+
+/* Creates and returns a cache of objects SIZE bytes long, each
+   aligned on an ALIGN-byte boundary, where ALIGN is a power of 2
+   or 0 for the default alignment.  If CTOR is nonnull, it is
+   called on every object when it is first added to the cache.
+   NAME identifies the cache in statistics and must remain valid.
+   Returns a null pointer if memory is not available. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, size_t align,
+                   kmem_ctor_func *ctor) 
+{
+  struct kmem_cache *c;
+  size_t leftover;
+  enum intr_level old_level;
+
+  ASSERT (name != NULL);
+  ASSERT (size > 0);
+  ASSERT ((align & (align - 1)) == 0);
+
+  if (align < sizeof (void *))
+    align = sizeof (void *);
+
+  c = malloc (sizeof *c);
+  if (c == NULL)
+    return NULL;
+  c->name = name;
+  c->size = size;
+  c->stride = ROUND_UP (size, align);
+  c->align = align;
+  c->ctor = ctor;
+  lock_init (&c->lock);
+  lock_set_name (&c->lock, name);
+  list_init (&c->partial);
+  list_init (&c->full);
+  list_init (&c->empty);
+  c->empty_cnt = 0;
+
+  /* Fit as many objects as possible, together with their free[]
+     entries, after the slab header. */
+  c->obj_cnt = ((PGSIZE - sizeof (struct slab))
+                / (c->stride + sizeof (uint16_t)));
+  while (c->obj_cnt > 0
+         && (ROUND_UP (sizeof (struct slab) + c->obj_cnt * sizeof (uint16_t),
+                       align)
+             + c->obj_cnt * c->stride) > PGSIZE)
+    c->obj_cnt--;
+  if (c->obj_cnt == 0)
+    PANIC ("%s: %zu-byte objects do not fit in a slab", name, size);
+  c->obj_ofs = ROUND_UP (sizeof (struct slab)
+                         + c->obj_cnt * sizeof (uint16_t), align);
+
+  /* Spread the leftover space across colors. */
+  leftover = PGSIZE - c->obj_ofs - c->obj_cnt * c->stride;
+  c->color_step = align > SLAB_COLOR_STEP ? align : SLAB_COLOR_STEP;
+  c->color_cnt = leftover / c->color_step + 1;
+  c->color_next = 0;
+
+  c->alloc_cnt = c->free_cnt = c->grow_cnt = c->reap_cnt = 0;
+  c->slab_cnt = c->in_use = 0;
+
+  old_level = intr_disable ();
+  list_push_back (&caches, &c->elem);
+  intr_set_level (old_level);
+
+  return c;
+}
+
+/* Allocates and returns an object from cache C, or a null
+   pointer if memory is not available.  The object is in the
+   state C's constructor left it in, or in which it was last
+   freed. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) 
+{
+  struct slab *s;
+  void *obj;
+
+  ASSERT (c != NULL);
+
+  lock_acquire (&c->lock);
+  if (!list_empty (&c->partial))
+    s = list_entry (list_front (&c->partial), struct slab, elem);
+  else if (!list_empty (&c->empty)) 
+    {
+      s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+      c->empty_cnt--;
+      list_push_front (&c->partial, &s->elem);
+    }
+  else 
+    {
+      s = slab_create (c);
+      if (s == NULL) 
+        {
+          lock_release (&c->lock);
+          return NULL;
+        }
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  obj = s->objs + s->free[--s->free_cnt] * c->stride;
+  if (s->free_cnt == 0) 
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->full, &s->elem);
+    }
+  c->alloc_cnt++;
+  c->in_use++;
+  lock_release (&c->lock);
+
+  return obj;
+}
+
+/* Returns OBJ, which must have been allocated from cache C, to
+   C. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) 
+{
+  struct slab *s;
+  size_t ofs;
+
+  ASSERT (c != NULL);
+  if (obj == NULL)
+    return;
+
+  s = pg_round_down (obj);
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+  ofs = (uint8_t *) obj - s->objs;
+  ASSERT (ofs % c->stride == 0);
+
+  lock_acquire (&c->lock);
+  ASSERT (s->free_cnt < c->obj_cnt);
+  s->free[s->free_cnt++] = ofs / c->stride;
+  if (s->free_cnt == c->obj_cnt) 
+    {
+      list_remove (&s->elem);
+      if (c->empty_cnt < SLAB_EMPTY_MAX) 
+        {
+          list_push_front (&c->empty, &s->elem);
+          c->empty_cnt++;
+        }
+      else
+        slab_destroy (c, s);
+    }
+  else if (s->free_cnt == 1) 
+    {
+      /* Was full. */
+      list_remove (&s->elem);
+      list_push_front (&c->partial, &s->elem);
+    }
+  c->free_cnt++;
+  c->in_use--;
+  lock_release (&c->lock);
+}
+
+/* Creates a new slab for cache C and constructs its objects.
+   Returns the slab, with all of its objects free, or a null
+   pointer if memory is not available. */
+static struct slab *
+slab_create (struct kmem_cache *c) 
+{
+  struct slab *s;
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&c->lock));
+
+  s = palloc_get_page (0);
+  if (s == NULL)
+    return NULL;
+
+  s->cache = c;
+  s->magic = SLAB_MAGIC;
+  s->objs = (uint8_t *) s + c->obj_ofs + c->color_next * c->color_step;
+  if (++c->color_next >= c->color_cnt)
+    c->color_next = 0;
+
+  /* Hand out the lowest-addressed objects first. */
+  s->free_cnt = c->obj_cnt;
+  for (i = 0; i < c->obj_cnt; i++) 
+    {
+      s->free[i] = c->obj_cnt - 1 - i;
+      if (c->ctor != NULL)
+        c->ctor (s->objs + i * c->stride);
+    }
+
+  c->grow_cnt++;
+  c->slab_cnt++;
+  return s;
+}
+
+/* Gives empty slab S, which is in no list, back to the page
+   allocator. */
+static void
+slab_destroy (struct kmem_cache *c, struct slab *s) 
+{
+  ASSERT (s->free_cnt == c->obj_cnt);
+
+  s->magic = 0;
+  palloc_free_page (s);
+  c->reap_cnt++;
+  c->slab_cnt--;
+}
+
+/* Prints statistics for each cache. */
+void
+kmem_print_stats (void) 
+{
+  struct list_elem *e;
+
+  if (list_empty (&caches))
+    return;
+
+  printf ("Slab caches (object size, per slab, slabs, in use, "
+          "allocs, frees, grows, reaps):\n");
+  for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e))
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+      printf ("  %-12s %5zu %4zu %5zu %6zu %8llu %8llu %6llu %6llu\n",
+              c->name, c->size, c->obj_cnt, c->slab_cnt, c->in_use,
+              c->alloc_cnt, c->free_cnt, c->grow_cnt, c->reap_cnt);
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/* Object caches.
+
+   A cache hands out objects of a single size, packed without
+   rounding into page-size "slabs", where malloc() would round
+   each up to a power of 2.  If a constructor is supplied, it is
+   run on each object once, when its slab is created, rather
+   than on every allocation: an object must be returned to the
+   cache in its constructed state. */
+
+struct kmem_cache;
+
+/* Object constructor. */
+typedef void kmem_ctor_func (void *obj);
+
+struct kmem_cache *kmem_cache_create (const char *name, size_t size,
+                                      size_t align, kmem_ctor_func *);
+void *kmem_cache_alloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+void kmem_print_stats (void);
+
+#endif /* threads/slab.h */
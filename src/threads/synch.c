@@ -29,8 +29,43 @@
 #include "threads/synch.h"
 #include <stdio.h>
 #include <string.h>
+#include "threads/atomic.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "devices/timer.h"
+
+static inline bool lock_cas (struct lock *);
+static bool lock_spin (struct lock *);
+static void lock_wait (struct lock *);
+static void lock_wake (struct lock *);
+static void lock_update_donation (struct lock *);
+static void wait_enqueue (struct heap *);
+static void mlfqs_refresh_waiters (struct heap *, int *epoch);
+static struct thread *wait_dequeue (struct heap *, int *epoch);
+static heap_less_func waiter_less;
+static heap_less_func lock_waiter_less;
+static inline uint64_t lock_stat_now (void);
+static inline void lock_stat_acquired (struct lock *, bool contended,
+                                       uint64_t wait_start);
+static inline void lock_stat_released (struct lock *);
+
+/* Stamps waiters in arrival order, so that wait queues are FIFO
+   among threads of equal priority. */
+static unsigned wait_seq;
+
+/* Maximum number of times lock_acquire() polls a lock whose
+   holder is running before it goes to sleep. */
+#define LOCK_SPIN_CNT 100
+
+#ifdef LOCK_STAT
+/* Locks given a name with lock_set_name(), whose statistics
+   lock_print_stats() reports. */
+static struct list named_locks = LIST_INITIALIZER (named_locks);
+
+/* Number of locks lock_print_stats() reports. */
+#define LOCK_STAT_TOP 10
+#endif
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -47,7 +82,8 @@ sema_init (struct semaphore *sema, unsigned value)
   ASSERT (sema != NULL);
 
   sema->value = value;
-  list_init (&sema->waiters);
+  heap_init (&sema->waiters, waiter_less, NULL);
+  sema->refresh_epoch = 0;
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -66,10 +102,10 @@ sema_down (struct semaphore *sema)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
+  trace (TRACE_SEMA_DOWN, (uintptr_t) sema, sema->value);
   while (sema->value == 0) 
     {
-      // insert current thread into waiters list by calling list_insert_ordered in stead of list_push_back
-      list_insert_ordered(&sema->waiters, &thread_current ()->elem, thread_compare_priority, NULL);
+      wait_enqueue (&sema->waiters);
       thread_block ();
     }
   sema->value--;
@@ -114,13 +150,11 @@ sema_up (struct semaphore *sema)
   ASSERT (sema != NULL);
 
   old_level = intr_disable ();
-  if (!list_empty (&sema->waiters)) {
-    // the priority of threads in the waiter list may have changed,
-    // sort them by list_sort() before calling thread_unblock()
-    list_sort(&(sema->waiters), thread_compare_priority, NULL);
-    thread_unblock (list_entry (list_pop_front (&sema->waiters),
-                                struct thread, elem));
-  }
+  trace (TRACE_SEMA_UP, (uintptr_t) sema, sema->value);
+  // waiters is kept in priority order as their priorities change
+  // (see thread_set_effective_priority()), so no re-sorting here
+  if (!heap_empty (&sema->waiters))
+    thread_unblock (wait_dequeue (&sema->waiters, &sema->refresh_epoch));
   sema->value++;
 
   // preemption may occur, due to thread_unblock()
@@ -187,13 +221,43 @@ lock_init (struct lock *lock)
   ASSERT (lock != NULL);
 
   lock->holder = NULL;
-  sema_init (&lock->semaphore, 1);
+  heap_init (&lock->waiters, lock_waiter_less, NULL);
+  lock->donee = NULL;
+  lock->name = NULL;
+#ifdef LOCK_STAT
+  memset (&lock->stat, 0, sizeof lock->stat);
+#endif
+}
+
+/* Names LOCK, which must have been initialized, NAME.  With
+   LOCK_STAT, also makes lock_print_stats() report LOCK's
+   statistics, so a lock given a name must never be destroyed. */
+void
+lock_set_name (struct lock *lock, const char *name) 
+{
+  ASSERT (lock != NULL);
+  ASSERT (name != NULL);
+
+#ifdef LOCK_STAT
+  if (lock->name == NULL) 
+    {
+      enum intr_level old_level = intr_disable ();
+      list_push_back (&named_locks, &lock->stat.elem);
+      intr_set_level (old_level);
+    }
+#endif
+  lock->name = name;
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
 
+   Locks are adaptive.  An uncontended lock is taken with a
+   single compare-and-swap, without disabling interrupts.  If the
+   holder is running on another CPU, it is likely to release the
+   lock soon, so we spin briefly before going to sleep.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
@@ -201,31 +265,26 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  uint64_t wait_start = 0;
+  bool contended;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
-  // if mlfqs is used, deactivate code related priority
-  if(!thread_mlfqs) {
-
-    // if the lock is held by other thread,
-    // save the address of the lock to lock_waiting_for of a current thread
-    struct thread *t_cur = thread_current();
-    if (lock->holder != NULL) {
-      t_cur->lock_waiting_for = lock;
-      list_push_back(&(lock->holder->donations), &(t_cur->donation_elem));
-      
-      // call donate_priority for priority donation
-      donate_priority(t_cur, 0);
-    }
+  contended = !lock_cas (lock);
+  if (contended)
+    wait_start = lock_stat_now ();
 
-    
-  }
-
-  sema_down (&lock->semaphore);
-  if(!thread_mlfqs)
-    thread_current()->lock_waiting_for = NULL;
-  lock->holder = thread_current ();
+  if (!contended || lock_spin (lock))
+    {
+      // threads left waiting by the previous holder now donate to us
+      if (lock->donee != NULL || !heap_empty (&lock->waiters))
+        lock_update_donation (lock);
+    }
+  else
+    lock_wait (lock);
+  lock_stat_acquired (lock, contended, wait_start);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -237,15 +296,15 @@ lock_acquire (struct lock *lock)
 bool
 lock_try_acquire (struct lock *lock)
 {
-  bool success;
-
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
 
-  success = sema_try_down (&lock->semaphore);
-  if (success)
-    lock->holder = thread_current ();
-  return success;
+  if (!lock_cas (lock))
+    return false;
+  if (lock->donee != NULL || !heap_empty (&lock->waiters))
+    lock_update_donation (lock);
+  lock_stat_acquired (lock, false, 0);
+  return true;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
@@ -256,18 +315,141 @@ lock_try_acquire (struct lock *lock)
 void
 lock_release (struct lock *lock) 
 {
+  struct thread *cur = thread_current ();
+  bool released;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
-  lock->holder = NULL;
-  
-  // if mlfqs is used, deactivate code related priority
-  if (!thread_mlfqs) {
-    remove_with_lock(lock); // lock이 release 되었으므로 donations 리스트를 비워준다.
-    refresh_priority();
-  }
+  lock_stat_released (lock);
+  released = atomic_cas_ptr ((void *volatile *) &lock->holder, cur, NULL);
+  ASSERT (released);
+
+  // a thread that queued up before the compare-and-swap above is
+  // seen here, and one that comes later finds the lock free.
+  if (lock->donee != NULL || !heap_empty (&lock->waiters))
+    lock_wake (lock);
+}
+
+/* Tries to make the current thread the holder of LOCK with a
+   single compare-and-swap. */
+static inline bool
+lock_cas (struct lock *lock) 
+{
+  return atomic_cas_ptr ((void *volatile *) &lock->holder,
+                         NULL, thread_current ());
+}
+
+/* Spins while LOCK's holder is running, which can only be on
+   another CPU, for at most LOCK_SPIN_CNT iterations.  Returns
+   true if we acquired LOCK, false if we should sleep instead. */
+static bool
+lock_spin (struct lock *lock) 
+{
+  int i;
+
+  for (i = 0; i < LOCK_SPIN_CNT; i++) 
+    {
+      struct thread *holder = lock->holder;
+
+      if (holder == NULL) 
+        {
+          if (lock_cas (lock))
+            return true;
+        }
+      else if (holder->status != THREAD_RUNNING)
+        return false;
+      cpu_relax ();
+    }
+  return false;
+}
+
+/* Sleeps in LOCK's waiters until we acquire it. */
+static void
+lock_wait (struct lock *lock) 
+{
+  struct thread *cur = thread_current ();
+  int64_t start = timer_ticks ();
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  while (!lock_cas (lock)) 
+    {
+      // join the lock's waiters so that our priority is donated to
+      // the holder (and further along the chain, see
+      // refresh_priority()), then wait for lock_wake().
+      cur->lock_waiting_for = lock;
+      cur->wait_seq = wait_seq++;
+      heap_insert (&lock->waiters, &cur->lock_elem);
+      lock_update_donation (lock);
+      thread_block ();
+    }
+  if (lock->donee != NULL || !heap_empty (&lock->waiters))
+    lock_update_donation (lock);
+  cur->lock_ticks += timer_ticks () - start;
+  intr_set_level (old_level);
+}
+
+/* Wakes the highest-priority thread waiting for LOCK, which the
+   current thread has just released, and withdraws the donations
+   we received through LOCK. */
+static void
+lock_wake (struct lock *lock) 
+{
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (!heap_empty (&lock->waiters)) 
+    {
+      struct thread *t = heap_entry (heap_pop (&lock->waiters),
+                                     struct thread, lock_elem);
+      t->lock_waiting_for = NULL;
+      thread_unblock (t);
+    }
+  lock_update_donation (lock);
+
+  // preemption may occur, due to thread_unblock()
+  check_list_preemption ();
+  intr_set_level (old_level);
+}
+
+/* Makes LOCK's waiters donate their priority to LOCK's current
+   holder, and to no other thread.  A thread that takes LOCK with
+   lock_cas() is not its donee until it, or a thread that starts
+   waiting, calls this function. */
+static void
+lock_update_donation (struct lock *lock) 
+{
+  struct thread *donee = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+
+  // if mlfqs or cfs is used, deactivate code related priority
+  if (!thread_mlfqs && !thread_cfs && lock->holder != NULL && !heap_empty (&lock->waiters))
+    donee = lock->holder;
 
-  sema_up (&lock->semaphore);
+  if (lock->donee != donee) 
+    {
+      struct thread *old_donee = lock->donee;
+
+      if (old_donee != NULL) 
+        {
+          heap_remove (&old_donee->held_locks, &lock->elem);
+          lock->donee = NULL;
+          refresh_priority (old_donee);
+        }
+      if (donee != NULL) 
+        {
+          heap_insert (&donee->held_locks, &lock->elem);
+          lock->donee = donee;
+        }
+    }
+  else if (donee != NULL)
+    heap_update (&donee->held_locks, &lock->elem);
+  if (donee != NULL)
+    refresh_priority (donee);
+  intr_set_level (old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -281,12 +463,137 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
-struct semaphore_elem 
-  {
-    struct list_elem elem;              /* List element. */
-    struct semaphore semaphore;         /* This semaphore. */
-  };
+/* Returns the priority that LOCK's waiters donate to its holder,
+   or PRI_MIN - 1 if there are none. */
+int
+lock_donated_priority (const struct lock *lock) 
+{
+  if (heap_empty (&lock->waiters))
+    return PRI_MIN - 1;
+  return heap_entry (heap_top (&lock->waiters), struct thread, lock_elem)->priority;
+}
+
+/* Returns the current time for lock statistics. */
+static inline uint64_t
+lock_stat_now (void) 
+{
+#ifdef LOCK_STAT
+  return timer_now_ns ();
+#else
+  return 0;
+#endif
+}
+
+/* Records that the current thread has just acquired LOCK, after
+   waiting since WAIT_START if CONTENDED. */
+static inline void
+lock_stat_acquired (struct lock *lock UNUSED, bool contended UNUSED,
+                    uint64_t wait_start UNUSED) 
+{
+#ifdef LOCK_STAT
+  struct lock_stat *s = &lock->stat;
+  uint64_t now = lock_stat_now ();
+
+  s->acquire_cnt++;
+  if (contended) 
+    {
+      /* The clock jumps when timer_calibrate() switches it to the
+         TSC, so an interval that spans that is thrown away. */
+      uint64_t wait = now >= wait_start ? now - wait_start : 0;
+      s->contended_cnt++;
+      s->wait_ns += wait;
+      if (wait > s->max_wait_ns)
+        s->max_wait_ns = wait;
+    }
+  s->acquired_ns = now;
+#endif
+}
+
+/* Records that the current thread is about to release LOCK. */
+static inline void
+lock_stat_released (struct lock *lock UNUSED) 
+{
+#ifdef LOCK_STAT
+  struct lock_stat *s = &lock->stat;
+  uint64_t now = lock_stat_now ();
+
+  if (now >= s->acquired_ns)
+    s->hold_ns += now - s->acquired_ns;
+#endif
+}
+
+#ifdef LOCK_STAT
+/* Orders named locks by number of contended acquisitions, then
+   by total wait time. */
+static bool
+lock_contention_less (const struct list_elem *a_,
+                      const struct list_elem *b_, void *aux UNUSED) 
+{
+  const struct lock_stat *a = list_entry (a_, struct lock_stat, elem);
+  const struct lock_stat *b = list_entry (b_, struct lock_stat, elem);
+
+  if (a->contended_cnt != b->contended_cnt)
+    return a->contended_cnt < b->contended_cnt;
+  return a->wait_ns < b->wait_ns;
+}
+#endif
+
+/* Prints statistics for the LOCK_STAT_TOP most contended named
+   locks.  Does nothing unless the kernel was built with
+   LOCK_STAT. */
+void
+lock_print_stats (void) 
+{
+#ifdef LOCK_STAT
+  struct list_elem *e;
+  int i;
+
+  if (list_empty (&named_locks))
+    return;
+
+  /* Sort most contended first. */
+  list_sort (&named_locks, lock_contention_less, NULL);
+  list_reverse (&named_locks);
+
+  printf ("Lock contention (acquisitions, contended, "
+          "total/max wait us, hold us):\n");
+  for (e = list_begin (&named_locks), i = 0;
+       e != list_end (&named_locks) && i < LOCK_STAT_TOP;
+       e = list_next (e), i++)
+    {
+      struct lock *lock = list_entry (e, struct lock, stat.elem);
+      struct lock_stat *s = &lock->stat;
+
+      printf ("  %-16s %10llu %10llu %10llu %8llu %12llu\n",
+              lock->name, s->acquire_cnt, s->contended_cnt,
+              s->wait_ns / 1000, s->max_wait_ns / 1000, s->hold_ns / 1000);
+    }
+#endif
+}
+
+/* Orders locks in a thread's held_locks heap by the priority
+   their waiters donate. */
+bool
+lock_priority_less (const struct heap_elem *a, const struct heap_elem *b,
+                    void *aux UNUSED) 
+{
+  return (lock_donated_priority (heap_entry (a, struct lock, elem))
+          < lock_donated_priority (heap_entry (b, struct lock, elem)));
+}
+
+/* Orders the threads in a lock's waiters heap by priority, and
+   later arrivals below earlier ones of the same priority. */
+static bool
+lock_waiter_less (const struct heap_elem *a_, const struct heap_elem *b_,
+                  void *aux UNUSED) 
+{
+  const struct thread *a = heap_entry (a_, struct thread, lock_elem);
+  const struct thread *b = heap_entry (b_, struct thread, lock_elem);
+
+  if (a->priority != b->priority)
+    return a->priority < b->priority;
+  return (int) (a->wait_seq - b->wait_seq) > 0;
+}
 
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
@@ -296,7 +603,8 @@ cond_init (struct condition *cond)
 {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  heap_init (&cond->waiters, waiter_less, NULL);
+  cond->refresh_epoch = 0;
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -322,18 +630,25 @@ cond_init (struct condition *cond)
 void
 cond_wait (struct condition *cond, struct lock *lock) 
 {
-  struct semaphore_elem waiter;
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
   
-  sema_init (&waiter.semaphore, 0);
-  // insert waiter into waiters list by calling list_insert_ordered in stead of list_push_back
-  list_insert_ordered(&cond->waiters, &waiter.elem, sema_compare_priority, NULL);
+  // the current thread itself waits in COND's queue.  it must be
+  // queued before LOCK is released, or a signal could be lost, and
+  // releasing LOCK may yield to a waiter that it wakes, so we might
+  // even be signaled before we get to block.  cond_signal() takes us
+  // off the queue, which is what we wait for.
+  old_level = intr_disable ();
+  wait_enqueue (&cond->waiters);
   lock_release (lock);
-  sema_down (&waiter.semaphore);
+  while (cur->wait_queue != NULL)
+    thread_block ();
+  intr_set_level (old_level);
   lock_acquire (lock);
 }
 
@@ -347,18 +662,24 @@ cond_wait (struct condition *cond, struct lock *lock)
 void
 cond_signal (struct condition *cond, struct lock *lock UNUSED) 
 {
+  enum intr_level old_level;
+
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
-  if (!list_empty (&cond->waiters)) {
-    // the priority of waiters may have changed,
-    // sort them by list_sort() before calling sema_up()
-    list_sort(&cond->waiters, sema_compare_priority, NULL);
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+  old_level = intr_disable ();
+  if (!heap_empty (&cond->waiters)) {
+    struct thread *t = wait_dequeue (&cond->waiters,
+                                     &cond->refresh_epoch);
+
+    // the waiter may not have blocked yet, see cond_wait()
+    if (t->status == THREAD_BLOCKED)
+      thread_unblock (t);
+    check_list_preemption ();
   }
+  intr_set_level (old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -373,27 +694,311 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
 
-  while (!list_empty (&cond->waiters))
+  while (!heap_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
 
-// if a's waiters' head's prirority is higher than b's waiters' head's prirority, return true, else return false
-bool sema_compare_priority(const struct list_elem *a, const struct list_elem *b, void *aux) {
-  const struct semaphore_elem* s1 = list_entry(a, struct semaphore_elem, elem);
-  const struct semaphore_elem* s2 = list_entry(b, struct semaphore_elem, elem);
+/* Returns true if the current thread holds RWLOCK for
+   reading. */
+static bool
+held_for_reading (const struct rwlock *rwlock) 
+{
+  struct thread *cur = thread_current ();
+  int i;
 
-  struct list_elem *s1_head_t_elem;
-  struct list_elem *s2_head_t_elem;
+  for (i = 0; i < cur->read_lock_cnt; i++)
+    if (cur->read_locks[i] == rwlock)
+      return true;
+  return false;
+}
 
-  if (!list_empty(&(s1->semaphore.waiters)) && !list_empty(&(s2->semaphore.waiters))) {
-    s1_head_t_elem = list_begin(&(s1->semaphore.waiters));
-    s2_head_t_elem = list_begin(&(s2->semaphore.waiters));
-    return thread_compare_priority(s1_head_t_elem, s2_head_t_elem, NULL);
-  }
-  else if(!list_empty(&(s1->semaphore.waiters))) {
-    return true;
-  }
-  else {
-    return false;
-  }
-}
\ No newline at end of file
+/* Records that the current thread holds RWLOCK for reading. */
+static void
+add_reader (struct rwlock *rwlock) 
+{
+  struct thread *cur = thread_current ();
+
+  ASSERT (cur->read_lock_cnt < RWLOCK_READ_MAX);
+  cur->read_locks[cur->read_lock_cnt++] = rwlock;
+}
+
+/* Records that the current thread no longer holds RWLOCK, which
+   it must hold, for reading. */
+static void
+remove_reader (struct rwlock *rwlock) 
+{
+  struct thread *cur = thread_current ();
+  int i;
+
+  for (i = 0; i < cur->read_lock_cnt; i++)
+    if (cur->read_locks[i] == rwlock) 
+      {
+        cur->read_locks[i] = cur->read_locks[--cur->read_lock_cnt];
+        return;
+      }
+  NOT_REACHED ();
+}
+
+/* Initializes readers-writer lock RWLOCK.  Any number of readers
+   may hold it at once, or a single writer.
+
+   Writers take precedence: once a writer is waiting for the
+   readers that hold RWLOCK to leave, arriving readers wait
+   behind it, so a stream of readers cannot starve a writer.
+   Threads waiting to enter are woken in priority order, as for a
+   lock, and donate their priority to the writer that holds
+   RWLOCK or is waiting for the readers to leave.  Readers do not
+   receive donations: a reader is recorded only in its own
+   thread, to catch a reader that tries to enter again, which
+   would deadlock. */
+void
+rwlock_init (struct rwlock *rwlock) 
+{
+  ASSERT (rwlock != NULL);
+
+  lock_init (&rwlock->lock);
+  rwlock->readers = 0;
+  rwlock->draining = false;
+  sema_init (&rwlock->drained, 0);
+}
+
+/* Acquires RWLOCK for reading, sleeping until no writer holds
+   or is waiting for it.  The current thread must not already
+   hold RWLOCK.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rwlock) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rwlock != NULL);
+  ASSERT (!rwlock_held_by_current_thread (rwlock));
+  ASSERT (!held_for_reading (rwlock));
+
+  lock_acquire (&rwlock->lock);
+  old_level = intr_disable ();
+  rwlock->readers++;
+  intr_set_level (old_level);
+  lock_release (&rwlock->lock);
+  add_reader (rwlock);
+}
+
+/* Releases RWLOCK, which the current thread must hold for
+   reading.  If it was the last reader and a writer is waiting,
+   lets the writer in. */
+void
+rwlock_release_read (struct rwlock *rwlock) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rwlock != NULL);
+
+  remove_reader (rwlock);
+  old_level = intr_disable ();
+  ASSERT (rwlock->readers > 0);
+  if (--rwlock->readers == 0 && rwlock->draining) 
+    {
+      rwlock->draining = false;
+      sema_up (&rwlock->drained);
+    }
+  intr_set_level (old_level);
+}
+
+/* Acquires RWLOCK for writing, sleeping until no other thread
+   holds it.  The current thread must not already hold RWLOCK,
+   for reading or writing, or it would wait for itself forever.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rwlock) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rwlock != NULL);
+  ASSERT (!held_for_reading (rwlock));
+
+  lock_acquire (&rwlock->lock);
+  old_level = intr_disable ();
+  if (rwlock->readers > 0) 
+    {
+      rwlock->draining = true;
+      sema_down (&rwlock->drained);
+    }
+  intr_set_level (old_level);
+}
+
+/* Releases RWLOCK, which the current thread must hold for
+   writing. */
+void
+rwlock_release_write (struct rwlock *rwlock) 
+{
+  ASSERT (rwlock != NULL);
+  ASSERT (rwlock_held_by_current_thread (rwlock));
+
+  lock_release (&rwlock->lock);
+}
+
+/* Returns true if the current thread holds RWLOCK for writing,
+   false otherwise. */
+bool
+rwlock_held_by_current_thread (const struct rwlock *rwlock) 
+{
+  ASSERT (rwlock != NULL);
+
+  return lock_held_by_current_thread (&rwlock->lock);
+}
+
+/* Initializes sequence lock SEQLOCK.
+
+   A sequence lock protects small, frequently read data that is
+   written rarely and only by one writer at a time.  Readers
+   never block or disable interrupts: they copy the data out and
+   retry if a write happened meanwhile:
+
+        do 
+          {
+            seq = seqlock_read_begin (&seqlock);
+            ...copy the data...
+          }
+        while (seqlock_read_retry (&seqlock, seq));
+
+   Writers must be serialized by the caller, and a reader must
+   never interrupt a writer, because it would wait forever for
+   the write to finish.  Writing with interrupts off, for
+   example from an interrupt handler, satisfies both. */
+void
+seqlock_init (struct seqlock *seqlock) 
+{
+  ASSERT (seqlock != NULL);
+
+  seqlock->seq = 0;
+}
+
+/* Begins a read of the data protected by SEQLOCK and returns the
+   sequence number to pass to seqlock_read_retry(). */
+unsigned
+seqlock_read_begin (const struct seqlock *seqlock) 
+{
+  unsigned seq;
+
+  do 
+    {
+      seq = seqlock->seq;
+      barrier ();
+    }
+  while (seq & 1);
+  return seq;
+}
+
+/* Returns true if the data read since seqlock_read_begin()
+   returned SEQ may be inconsistent, so that the read must be
+   retried. */
+bool
+seqlock_read_retry (const struct seqlock *seqlock, unsigned seq) 
+{
+  barrier ();
+  return seqlock->seq != seq;
+}
+
+/* Begins a write of the data protected by SEQLOCK. */
+void
+seqlock_write_begin (struct seqlock *seqlock) 
+{
+  ASSERT ((seqlock->seq & 1) == 0);
+
+  seqlock->seq++;
+  barrier ();
+}
+
+/* Ends a write of the data protected by SEQLOCK. */
+void
+seqlock_write_end (struct seqlock *seqlock) 
+{
+  ASSERT ((seqlock->seq & 1) == 1);
+
+  barrier ();
+  seqlock->seq++;
+}
+
+/* Queues the current thread on wait queue QUEUE, a semaphore's
+   or condition variable's waiters.  Interrupts must be off. */
+static void
+wait_enqueue (struct heap *queue) 
+{
+  struct thread *cur = thread_current ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (cur->wait_queue == NULL);
+
+  cur->wait_queue = queue;
+  cur->wait_seq = wait_seq++;
+  heap_insert (queue, &cur->wait_elem);
+}
+
+/* Under mlfqs, blocked threads decay their recent_cpu lazily, so
+   brings the priorities of the threads in wait queue QUEUE up to
+   date.  Each is taken out of QUEUE while it is refreshed, so
+   that its new priority does not disturb the walk, and put back
+   with its original arrival stamp.
+
+   *EPOCH is the mlfqs epoch that QUEUE was last refreshed in.  A
+   waiter's priority changes only when the epoch does (and through
+   donation, which moves it in QUEUE itself), and a thread that
+   starts waiting is current, so QUEUE is rebuilt at most once per
+   epoch, not on every wakeup.  Interrupts must be off. */
+static void
+mlfqs_refresh_waiters (struct heap *queue, int *epoch) 
+{
+  struct heap refreshed;
+
+  if (*epoch == mlfqs_decay_epoch ())
+    return;
+  *epoch = mlfqs_decay_epoch ();
+
+  heap_init (&refreshed, waiter_less, NULL);
+  while (!heap_empty (queue)) 
+    {
+      struct thread *t = heap_entry (heap_pop (queue),
+                                     struct thread, wait_elem);
+      t->wait_queue = NULL;
+      mlfqs_refresh (t);
+      t->wait_queue = queue;
+      heap_insert (&refreshed, &t->wait_elem);
+    }
+  *queue = refreshed;
+}
+
+/* Removes and returns the highest-priority thread, the earliest
+   among equals, from nonempty wait queue QUEUE, whose refresh
+   epoch is *EPOCH (see mlfqs_refresh_waiters()).  Interrupts must
+   be off. */
+static struct thread *
+wait_dequeue (struct heap *queue, int *epoch) 
+{
+  struct thread *t;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_mlfqs)
+    mlfqs_refresh_waiters (queue, epoch);
+  t = heap_entry (heap_pop (queue), struct thread, wait_elem);
+  t->wait_queue = NULL;
+  return t;
+}
+
+/* Orders the threads in a wait queue by priority, and later
+   arrivals below earlier ones of the same priority. */
+static bool
+waiter_less (const struct heap_elem *a_, const struct heap_elem *b_,
+             void *aux UNUSED) 
+{
+  const struct thread *a = heap_entry (a_, struct thread, wait_elem);
+  const struct thread *b = heap_entry (b_, struct thread, wait_elem);
+
+  if (a->priority != b->priority)
+    return a->priority < b->priority;
+  return (int) (a->wait_seq - b->wait_seq) > 0;
+}
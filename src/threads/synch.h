@@ -1,14 +1,17 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* A counting semaphore. */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Waiting threads, by priority. */
+    int refresh_epoch;          /* mlfqs epoch of waiters' priorities. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -17,25 +20,51 @@ bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
 
-bool sema_compare_priority(const struct list_elem *a, const struct list_elem *b, void *aux);
+/* Lock contention statistics, kept when the kernel is built
+   with LOCK_STAT defined ("make LOCK_STAT=1").  Times are in
+   nanoseconds.  They are updated only while the lock is held,
+   so the lock itself protects them. */
+#ifdef LOCK_STAT
+struct lock_stat
+  {
+    unsigned long long acquire_cnt;     /* # of acquisitions. */
+    unsigned long long contended_cnt;   /* # that found the lock held. */
+    uint64_t wait_ns;                   /* Total time spent waiting. */
+    uint64_t max_wait_ns;               /* Longest single wait. */
+    uint64_t hold_ns;                   /* Total time held. */
+    uint64_t acquired_ns;               /* When the holder acquired it. */
+    struct list_elem elem;              /* Element in named lock list. */
+  };
+#endif
 
 /* Lock. */
 struct lock 
   {
-    struct thread *holder;      /* Thread holding lock (for debugging). */
-    struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct thread *holder;      /* Thread holding lock, or NULL. */
+    struct heap waiters;        /* Waiting threads, by priority. */
+    struct thread *donee;       /* Thread the waiters donate to, or NULL. */
+    struct heap_elem elem;      /* Element in donee's held_locks heap. */
+    const char *name;           /* Name (for debugging), or NULL. */
+#ifdef LOCK_STAT
+    struct lock_stat stat;      /* Contention statistics. */
+#endif
   };
 
 void lock_init (struct lock *);
+void lock_set_name (struct lock *, const char *name);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+int lock_donated_priority (const struct lock *);
+heap_less_func lock_priority_less;
+void lock_print_stats (void);
 
 /* Condition variable. */
 struct condition 
   {
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Waiting threads, by priority. */
+    int refresh_epoch;          /* mlfqs epoch of waiters' priorities. */
   };
 
 void cond_init (struct condition *);
@@ -43,6 +72,35 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Readers-writer lock. */
+struct rwlock 
+  {
+    struct lock lock;           /* Held by the writer, or a writer waiting
+                                   for readers to leave. */
+    unsigned readers;           /* Number of readers holding the lock. */
+    bool draining;              /* Is a writer waiting on `drained'? */
+    struct semaphore drained;   /* Upped when the last reader leaves. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_by_current_thread (const struct rwlock *);
+
+/* Sequence lock. */
+struct seqlock 
+  {
+    unsigned seq;               /* Odd while a write is in progress. */
+  };
+
+void seqlock_init (struct seqlock *);
+unsigned seqlock_read_begin (const struct seqlock *);
+bool seqlock_read_retry (const struct seqlock *, unsigned seq);
+void seqlock_write_begin (struct seqlock *);
+void seqlock_write_end (struct seqlock *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
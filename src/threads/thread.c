@@ -10,8 +10,10 @@
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "threads/fixed_point.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -24,18 +26,38 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
-
-/* List of prcesses in THREAD_BLOCKED state */
-//add new struct
-static struct list list_sleep_thread;
+/* Run queue of threads in THREAD_READY state, that is, threads
+   that are ready to run but not actually running.  There is one
+   FIFO list per priority level, and bit P of ready_bitmap is set
+   exactly when ready_queues[P] is nonempty, so the highest ready
+   priority is found without scanning. */
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_bitmap;
+static size_t ready_cnt;        /* # of non-real-time ready threads. */
+
+/* Under the completely fair scheduler, ready threads are kept in
+   cfs_tree instead, ordered by vruntime, so the next thread to
+   run is always the tree's cached leftmost node.  min_vruntime
+   only ever increases; it tracks the smallest vruntime and
+   anchors threads that wake up or are created. */
+static struct rb_tree cfs_tree;
+static unsigned long cfs_load;  /* Sum of weights in cfs_tree. */
+static int64_t min_vruntime;
+
+/* Real-time threads that are ready and have budget left, by
+   earliest deadline.  They run ahead of all of the above. */
+static struct heap rt_queue;
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
+/* Threads that have exited but whose pages are not freed yet.
+   thread_schedule_tail() runs with interrupts off and so cannot
+   take the page allocator's lock; the pages are freed later by
+   reap_dying_threads(). */
+static struct list dying_list;
+
 /* Idle thread. */
 static struct thread *idle_thread;
 
@@ -57,6 +79,8 @@ struct kernel_thread_frame
 static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
+static long long rt_throttle_cnt; /* # of real-time budget overruns. */
+static long long rt_miss_cnt;   /* # of real-time deadlines missed. */
 
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
@@ -67,8 +91,64 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
-/* load_avg value for mlfqs */
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-sched=cfs". */
+bool thread_cfs;
+
+/* Completely fair scheduler.  Each timer tick a thread runs adds
+   CFS_TICK_VRUNTIME * CFS_NICE_0_WEIGHT / weight to its vruntime,
+   so a thread with twice the weight ages half as fast and gets
+   twice the CPU time.  The thread with the least vruntime runs
+   next.  Nothing is ever recomputed for all threads at once. */
+#define CFS_NICE_0_WEIGHT 1024  /* Weight of nice 0. */
+#define CFS_TICK_VRUNTIME 1024  /* vruntime of one tick at nice 0. */
+#define CFS_LATENCY 8           /* Ticks in which each ready thread should run. */
+#define CFS_MIN_GRANULARITY 1   /* Ticks a thread may run before preemption. */
+#define CFS_WAKEUP_GRANULARITY CFS_TICK_VRUNTIME /* Lead needed to preempt. */
+#define CFS_SLEEPER_CREDIT (CFS_LATENCY * CFS_TICK_VRUNTIME / 2)
+
+/* Real-time threads.  rt_util is the sum of the admitted threads'
+   budget / period, in units of 1 / RT_UTIL_ONE.  Each share is
+   rounded up, so admission errs on the safe side. */
+#define RT_UTIL_ONE (1u << 16)
+static unsigned rt_util;
+static long long rt_thread_cnt;         /* # of real-time threads admitted. */
+
+/* Weight of each nice value from NICE_MIN to NICE_MAX.  Each step
+   changes the weight by about 1.25x, so one nice level is worth
+   about 10% of the CPU between two threads.  These are the
+   weights used by Linux, extended to nice 20. */
+#define NICE_MIN -20
+#define NICE_MAX 20
+static const unsigned cfs_weights[NICE_MAX - NICE_MIN + 1] =
+  {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */  9548,  7620,  6100,  4904,  3906,
+    /*  -5 */  3121,  2501,  1991,  1586,  1277,
+    /*   0 */  1024,   820,   655,   526,   423,
+    /*   5 */   335,   272,   215,   172,   137,
+    /*  10 */   110,    87,    70,    56,    45,
+    /*  15 */    36,    29,    23,    18,    15,
+    /*  20 */    12,
+  };
+
+/* load_avg value for mlfqs, updated in the timer interrupt */
 fixed_t load_avg;
+static struct seqlock load_avg_seqlock;
+
+/* Lazy recent_cpu decay for mlfqs.  Only runnable threads are
+   decayed once a second.  A blocked thread remembers the epoch
+   (second) of its last decay, and the coefficients of the last
+   DECAY_HISTORY epochs are kept so that the missed decays can be
+   replayed exactly when the thread wakes up.  decay_list holds
+   the blocked threads that are not yet at the fixed point
+   recent_cpu == nice == 0, oldest epoch first; the ones about to
+   fall out of the history are caught up by mlfqs_update_all(). */
+#define DECAY_HISTORY 64
+static int decay_epoch;                 /* # of one-second updates so far. */
+static fixed_t decay_coef[DECAY_HISTORY]; /* Coefficient of each epoch. */
+static struct list decay_list;          /* Blocked threads still decaying. */
 
 static void kernel_thread (thread_func *, void *aux);
 
@@ -76,26 +156,47 @@ static void idle (void *aux UNUSED);
 static struct thread *running_thread (void);
 static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
+static void reap_dying_threads (void);
+static struct thread *new_thread (const char *name, int priority,
+                                  thread_func *, void *aux);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
-bool thread_compare_priority(const struct list_elem *e1, const struct list_elem *e2, void *aux UNUSED);
+static void ready_queue_push (struct thread *);
+static void ready_queue_remove (struct thread *);
+static struct thread *ready_queue_pop (void);
+static int ready_queue_max_priority (void);
+static bool is_idle_thread (const struct thread *);
+static void thread_set_effective_priority (struct thread *, int priority);
+static int mlfqs_clamped_priority (struct thread *);
+static void mlfqs_catch_up (struct thread *);
+static void mlfqs_park (struct thread *);
+static void decay_list_remove (struct thread *);
 void check_list_preemption(void);
-void donate_priority(struct thread* t, int depth);
-void remove_with_lock(struct lock *lock);
-void refresh_priority(void);
+void refresh_priority(struct thread *t);
 void mlfqs_priority(struct thread *t);
 int calc_priority(fixed_t _recent_cpu, int _nice);
 void mlfqs_recent_cpu (struct thread *t);
 fixed_t calc_recent_cpu(fixed_t _load_avg, fixed_t _recent_cpu, int _nice);
+fixed_t calc_decay_coef(fixed_t _load_avg);
 void mlfqs_load_avg(void);
 fixed_t calc_load_avg(fixed_t _load_avg, int _ready_threads);
 void mlfqs_recent_cpu_incr(void);
 void mlfqs_update_all(void);
-void mlfqs_update_all_recent_cpu(void);
-void mlfqs_update_all_priority(void);
+static unsigned cfs_weight (const struct thread *);
+static void cfs_update_min_vruntime (void);
+static void cfs_place (struct thread *);
+static bool cfs_tick (struct thread *);
+static bool cfs_should_preempt (struct thread *);
+static bool rt_admit (int64_t period, int64_t budget, unsigned *util);
+static void rt_release (unsigned util);
+static void rt_start_period (struct thread *, int64_t start);
+static void rt_wakeup (struct thread *);
+static bool rt_tick (struct thread *);
+static void rt_replenish (void *t);
+static bool rt_should_preempt (struct thread *);
 
 
 /* Initializes the threading system by transforming the code
@@ -114,14 +215,19 @@ void mlfqs_update_all_priority(void);
 void
 thread_init (void) 
 {
+  int pri;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
+  for (pri = PRI_MIN; pri <= PRI_MAX; pri++)
+    list_init (&ready_queues[pri]);
+  rb_init (&cfs_tree, thread_vruntime_less, NULL);
+  heap_init (&rt_queue, thread_deadline_less, NULL);
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  lock_set_name (&tid_lock, "tid");
   list_init (&all_list);
-  //sleep thread list인 list_sleep_thread를 초기화한다.
-  //list_sleep_thread 초기화 추가
-  list_init(&list_sleep_thread);
+  list_init (&dying_list);
+  list_init (&decay_list);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
@@ -148,6 +254,7 @@ thread_start (void)
 
   /* Initialize load_avg value */
   load_avg = convert_i2f(0);
+  seqlock_init(&load_avg_seqlock);
 
   /* Start preemptive thread scheduling. */
   intr_enable ();
@@ -168,22 +275,102 @@ thread_tick (void)
     idle_ticks++;
 #ifdef USERPROG
   else if (t->pagedir != NULL)
-    user_ticks++;
+    {
+      user_ticks++;
+      t->user_ticks++;
+    }
 #endif
   else
-    kernel_ticks++;
+    {
+      kernel_ticks++;
+      t->kernel_ticks++;
+    }
 
   /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  if (t->rt)
+    {
+      if (rt_tick (t))
+        intr_yield_on_return ();
+    }
+  else if (thread_cfs)
+    {
+      if (t != idle_thread && cfs_tick (t))
+        intr_yield_on_return ();
+    }
+  else if (++thread_ticks >= TIME_SLICE)
     intr_yield_on_return ();
 }
 
+/* Credits CNT timer ticks during which the CPU halted in the idle
+   thread without taking a timer interrupt.  Called by the timer
+   code in tickless idle. */
+void
+thread_add_idle_ticks (int64_t cnt) 
+{
+  idle_ticks += cnt;
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void) 
 {
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  if (rt_thread_cnt > 0)
+    printf ("Real-time: %lld threads, %lld throttled, "
+            "%lld deadlines missed\n",
+            rt_thread_cnt, rt_throttle_cnt, rt_miss_cnt);
+}
+
+/* Takes a snapshot of the statistics of every thread, storing
+   the first MAX of them in STATS[].  Returns the number of
+   threads, which may be more than MAX. */
+size_t
+thread_stats (struct thread_stats *stats, size_t max)
+{
+  struct list_elem *e;
+  enum intr_level old_level;
+  size_t cnt = 0;
+
+  old_level = intr_disable ();
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e), cnt++)
+    {
+      struct thread *t = list_entry (e, struct thread, allelem);
+      struct thread_stats *st;
+
+      if (cnt >= max)
+        continue;
+      st = &stats[cnt];
+      st->tid = t->tid;
+      strlcpy (st->name, t->name, sizeof st->name);
+      st->status = t->status;
+      st->priority = t->priority;
+      st->nice = t->nice;
+      st->user_ticks = t->user_ticks;
+      st->kernel_ticks = t->kernel_ticks;
+      st->voluntary_switches = t->voluntary_switches;
+      st->involuntary_switches = t->involuntary_switches;
+      st->ready_ticks = t->ready_ticks;
+      st->lock_ticks = t->lock_ticks;
+    }
+  intr_set_level (old_level);
+
+  return cnt;
+}
+
+/* Returns the name of thread state STATUS. */
+const char *
+thread_status_name (enum thread_status status)
+{
+  switch (status)
+    {
+    case THREAD_RUNNING: return "running";
+    case THREAD_READY: return "ready";
+    case THREAD_BLOCKED: return "blocked";
+    case THREAD_DYING: return "dying";
+    default: return "unknown";
+    }
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -204,23 +391,100 @@ thread_print_stats (void)
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux) 
+{
+  struct thread *t;
+  tid_t tid;
+
+  t = new_thread (name, priority, function, aux);
+  if (t == NULL)
+    return TID_ERROR;
+  tid = t->tid;
+
+  /* Add to run queue. */
+  thread_unblock (t);
+
+  // compare created thread's priority with current thread's
+  // if created thread's priority is higher than cur's, call thread_yield
+  // (cfs ignores priority and compares vruntime instead)
+  if (thread_cfs) {
+    check_list_preemption();
+  } else if (priority > thread_current()->priority) {
+    thread_yield();
+  }
+
+  return tid;
+}
+
+/* Creates a new real-time kernel thread named NAME, which
+   executes FUNCTION passing AUX as the argument, and adds it to
+   the ready queue.  In every PERIOD timer ticks, the thread may
+   run for up to BUDGET ticks, ahead of all threads that are not
+   real-time.  Among real-time threads, the one whose period ends
+   first runs first.  A thread that uses up its budget is not
+   run again until its period ends.
+
+   Returns the thread identifier for the new thread, or TID_ERROR
+   if creation fails or if the thread's BUDGET / PERIOD share of
+   the CPU, added to that of the real-time threads already
+   running, would exceed 1.  As long as this holds, every
+   real-time thread gets its budget within each of its periods.
+
+   The thread is created with priority PRI_MAX, which is what it
+   donates while it waits for a lock. */
+tid_t
+thread_create_rt (const char *name, int64_t period, int64_t budget,
+                  thread_func *function, void *aux) 
+{
+  struct thread *t;
+  unsigned util;
+  tid_t tid;
+
+  ASSERT (0 < budget && budget <= period);
+
+  if (!rt_admit (period, budget, &util))
+    return TID_ERROR;
+  t = new_thread (name, PRI_MAX, function, aux);
+  if (t == NULL)
+    {
+      rt_release (util);
+      return TID_ERROR;
+    }
+  tid = t->tid;
+
+  t->rt = true;
+  t->rt_period = period;
+  t->rt_budget = budget;
+  t->rt_util = util;
+  thread_unblock (t);
+  check_list_preemption ();
+
+  return tid;
+}
+
+/* Allocates and initializes a thread named NAME with the given
+   initial PRIORITY, which will execute FUNCTION passing AUX as
+   the argument once it is unblocked.  Returns the new thread, or
+   a null pointer if memory is exhausted. */
+static struct thread *
+new_thread (const char *name, int priority,
+            thread_func *function, void *aux) 
 {
   struct thread *t;
   struct kernel_thread_frame *kf;
   struct switch_entry_frame *ef;
   struct switch_threads_frame *sf;
-  tid_t tid;
 
   ASSERT (function != NULL);
 
   /* Allocate thread. */
+  reap_dying_threads ();
   t = palloc_get_page (PAL_ZERO);
   if (t == NULL)
-    return TID_ERROR;
+    return NULL;
 
   /* Initialize thread. */
   init_thread (t, name, priority);
-  tid = t->tid = allocate_tid ();
+  t->tid = allocate_tid ();
 
   /* Stack frame for kernel_thread(). */
   kf = alloc_frame (t, sizeof *kf);
@@ -237,16 +501,7 @@ thread_create (const char *name, int priority,
   sf->eip = switch_entry;
   sf->ebp = 0;
 
-  /* Add to run queue. */
-  thread_unblock (t);
-
-  // compare created thread's priority with current thread's
-  // if created thread's priority is higher than cur's, call thread_yield
-  if (priority > thread_current()->priority) {
-    thread_yield();
-  }
-
-  return tid;
+  return t;
 }
 
 /* Puts the current thread to sleep.  It will not be scheduled
@@ -258,10 +513,15 @@ thread_create (const char *name, int priority,
 void
 thread_block (void) 
 {
+  struct thread *cur = thread_current ();
+
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
 
-  thread_current ()->status = THREAD_BLOCKED;
+  trace (TRACE_THREAD_BLOCK, (uintptr_t) __builtin_return_address (0), 0);
+  if (thread_mlfqs && !cur->rt)
+    mlfqs_park (cur);
+  cur->status = THREAD_BLOCKED;
   schedule ();
 }
 
@@ -283,10 +543,19 @@ thread_unblock (struct thread *t)
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
 
-  // insert t into ready_list by calling list_insert_ordered in stead of list_push_back
-  list_insert_ordered(&ready_list, &t->elem, thread_compare_priority, NULL);
-
+  trace (TRACE_THREAD_UNBLOCK, t->tid, t->priority);
+  if (thread_mlfqs && !t->rt)
+    {
+      mlfqs_catch_up (t);
+      decay_list_remove (t);
+    }
+  if (t->rt)
+    rt_wakeup (t);
+  else if (thread_cfs)
+    cfs_place (t);
+  ready_queue_push (t);
   t->status = THREAD_READY;
+  t->ready_since = timer_ticks ();
   intr_set_level (old_level);
 }
 
@@ -333,11 +602,14 @@ thread_exit (void)
 #ifdef USERPROG
   process_exit ();
 #endif
+  reap_dying_threads ();
 
   /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
   intr_disable ();
+  if (thread_current ()->rt)
+    rt_release (thread_current ()->rt_util);
   list_remove (&thread_current()->allelem);
   thread_current ()->status = THREAD_DYING;
   schedule ();
@@ -355,10 +627,10 @@ thread_yield (void)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  if (cur != idle_thread) 
-    // insert t into ready_list by calling list_insert_ordered in stead of list_push_back
-    list_insert_ordered(&ready_list, &cur->elem, thread_compare_priority, NULL);
+  if (!is_idle_thread (cur)) 
+    ready_queue_push (cur);
   cur->status = THREAD_READY;
+  cur->ready_since = timer_ticks ();
   schedule ();
   intr_set_level (old_level);
 }
@@ -385,12 +657,13 @@ void
 thread_set_priority (int new_priority) 
 {
   //mlfqs스케쥴러를 사용할때는 새로운 priority를 임의로 설정할 수 없도록 해야 한다.
-  if(!thread_mlfqs)
+  //cfs도 priority를 사용하지 않는다.
+  if(!thread_mlfqs && !thread_cfs)
   {
     thread_current ()->origin_priority = new_priority;
     // set origin_priority as new one
     // then, it is nesessary to compare new origin priority and donation priority
-    refresh_priority();
+    refresh_priority(thread_current ());
 
     // after set priority as new one,
     // compare ready list elements' priority with current's
@@ -421,12 +694,12 @@ thread_set_nice (int nice)
   cur->nice = nice;
 
   //nice 계산하였으니 priority 다시 계산
-  mlfqs_priority(cur);
+  //cfs는 priority 대신 nice에서 weight를 바로 구한다.
+  //real-time thread는 PRI_MAX를 유지한다.
+  if (!thread_cfs && !cur->rt)
+    mlfqs_priority(cur);
 
-  // sort thread in ready_list for new priority
-  list_sort(&ready_list, thread_compare_priority, NULL);
-
-  if(cur!=idle_thread) {
+  if(!is_idle_thread(cur)) {
     //priority에 따라 다시 스케쥴링
     check_list_preemption();
   }
@@ -451,12 +724,14 @@ thread_get_nice (void)
 int
 thread_get_load_avg (void) 
 {
-  enum intr_level prev_level = intr_disable();
-  int load_avg_100;
-
-  load_avg_100 = convert_f2i_round(mul_inf(100, load_avg));
-  intr_set_level(prev_level);
-  return load_avg_100;
+  fixed_t cur_load_avg;
+  unsigned seq;
+
+  do {
+    seq = seqlock_read_begin(&load_avg_seqlock);
+    cur_load_avg = load_avg;
+  } while (seqlock_read_retry(&load_avg_seqlock, seq));
+  return convert_f2i_round(mul_inf(100, cur_load_avg));
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
@@ -496,6 +771,15 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Use the time to zero a free page for palloc, then check
+         again for something to run. */
+      if (palloc_zero_idle ())
+        continue;
+
+      /* Nothing is runnable, so there is no point in taking a
+         timer interrupt until the next deadline. */
+      timer_idle_enter ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -565,13 +849,28 @@ init_thread (struct thread *t, const char *name, int priority)
   /* initialize member variables for multiple donation */
   t->origin_priority = priority;
   t->lock_waiting_for = NULL;
-  list_init(&(t->donations));
+  t->wait_queue = NULL;
+  heap_init(&t->held_locks, lock_priority_less, NULL);
 
   /* initialize member variables for advanced scheduler */
   t->nice = 0;
   t->recent_cpu = 0;
 
+  /* start new threads level with the others */
+  t->vruntime = min_vruntime;
+
+#ifdef USERPROG
+  t->exit_status = -1;
+  list_init (&t->children);
+  list_init (&t->files);
+  t->next_fd = 2;
+#endif
+#ifdef VM
+  list_init (&t->mappings);
+#endif
+
   old_level = intr_disable ();
+  t->decay_epoch = decay_epoch;
   list_push_back (&all_list, &t->allelem);
   intr_set_level (old_level);
 }
@@ -597,10 +896,146 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
-    return idle_thread;
+  struct thread *t = ready_queue_pop ();
+
+  if (t == NULL)
+    t = idle_thread;
+  return t;
+}
+
+/* Appends T to the run queue for its current priority.
+   Interrupts must be off. */
+static void
+ready_queue_push (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+  if (t->rt)
+    {
+      /* A throttled thread is only put in the run queue by
+         rt_replenish(). */
+      if (!t->rt_throttled)
+        heap_insert (&rt_queue, &t->rt_elem);
+      return;
+    }
+  if (thread_cfs)
+    {
+      rb_insert (&cfs_tree, &t->cfs_node);
+      cfs_load += cfs_weight (t);
+    }
   else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+    {
+      list_push_back (&ready_queues[t->priority], &t->elem);
+      ready_bitmap |= (uint64_t) 1 << t->priority;
+    }
+  ready_cnt++;
+}
+
+/* Removes T from the run queue.  T's priority must not have
+   changed since it was pushed.  Interrupts must be off. */
+static void
+ready_queue_remove (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->rt)
+    {
+      if (!t->rt_throttled)
+        heap_remove (&rt_queue, &t->rt_elem);
+      return;
+    }
+  ASSERT (ready_cnt > 0);
+  if (thread_cfs)
+    {
+      rb_remove (&cfs_tree, &t->cfs_node);
+      cfs_load -= cfs_weight (t);
+    }
+  else
+    {
+      list_remove (&t->elem);
+      if (list_empty (&ready_queues[t->priority]))
+        ready_bitmap &= ~((uint64_t) 1 << t->priority);
+    }
+  ready_cnt--;
+}
+
+/* Removes and returns the real-time thread with the earliest
+   deadline in the run queue, if any, or else the first thread of
+   the highest priority, or, under the completely fair scheduler,
+   the thread with the least vruntime.  Returns a null pointer if
+   the run queue is empty.  Interrupts must be off. */
+static struct thread *
+ready_queue_pop (void)
+{
+  struct thread *t = NULL;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!heap_empty (&rt_queue))
+    t = heap_entry (heap_top (&rt_queue), struct thread, rt_elem);
+  else if (thread_cfs)
+    {
+      if (!rb_empty (&cfs_tree))
+        t = rb_entry (rb_first (&cfs_tree), struct thread, cfs_node);
+    }
+  else if (ready_cnt > 0)
+    t = list_entry (list_front (&ready_queues[ready_queue_max_priority ()]),
+                    struct thread, elem);
+  if (t != NULL)
+    ready_queue_remove (t);
+  return t;
+}
+
+/* Returns the highest priority of any ready thread, or
+   PRI_MIN - 1 if the run queue is empty.  The bitmap is split
+   into 32-bit halves so that __builtin_clz() compiles to a
+   single BSR instead of a call into libgcc. */
+static int
+ready_queue_max_priority (void)
+{
+  uint32_t hi = ready_bitmap >> 32;
+  uint32_t lo = ready_bitmap;
+
+  if (hi != 0)
+    return 63 - __builtin_clz (hi);
+  else if (lo != 0)
+    return 31 - __builtin_clz (lo);
+  else
+    return PRI_MIN - 1;
+}
+
+/* Returns true if T is the idle thread. */
+static bool
+is_idle_thread (const struct thread *t)
+{
+  return t == idle_thread;
+}
+
+/* Sets T's effective priority to PRIORITY.  If T is in the run
+   queue, it is moved to the tail of the queue for its new
+   priority; if it is waiting on a semaphore or condition
+   variable, it is moved to its new place among the waiters. */
+static void
+thread_set_effective_priority (struct thread *t, int priority)
+{
+  enum intr_level old_level;
+
+  if (t->priority == priority)
+    return;
+
+  old_level = intr_disable ();
+  if (t->status == THREAD_READY)
+    {
+      ready_queue_remove (t);
+      t->priority = priority;
+      ready_queue_push (t);
+    }
+  else
+    t->priority = priority;
+  if (t->wait_queue != NULL)
+    heap_update (t->wait_queue, &t->wait_elem);
+  intr_set_level (old_level);
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -637,15 +1072,39 @@ thread_schedule_tail (struct thread *prev)
   process_activate ();
 #endif
 
-  /* If the thread we switched from is dying, destroy its struct
-     thread.  This must happen late so that thread_exit() doesn't
-     pull out the rug under itself.  (We don't free
-     initial_thread because its memory was not obtained via
-     palloc().) */
+  /* If the thread we switched from is dying, queue its struct
+     thread to be destroyed.  This must happen late so that
+     thread_exit() doesn't pull out the rug under itself.  (We
+     don't free initial_thread because its memory was not
+     obtained via palloc().) */
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      list_push_back (&dying_list, &prev->elem);
+    }
+}
+
+/* Frees the pages of the threads on dying_list.  Must be called
+   from a context that may take the page allocator's lock, that
+   is, not from an interrupt handler or from the scheduler. */
+static void
+reap_dying_threads (void) 
+{
+  ASSERT (!intr_context ());
+
+  for (;;) 
+    {
+      enum intr_level old_level = intr_disable ();
+      struct thread *t = list_empty (&dying_list)
+                         ? NULL
+                         : list_entry (list_pop_front (&dying_list),
+                                       struct thread, elem);
+      intr_set_level (old_level);
+
+      if (t == NULL)
+        break;
+      ASSERT (t->status == THREAD_DYING);
+      palloc_free_page (t);
     }
 }
 
@@ -667,8 +1126,21 @@ schedule (void)
   ASSERT (cur->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
 
+  if (is_idle_thread (cur))
+    timer_idle_exit ();
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      /* Update statistics. */
+      if (cur->status == THREAD_BLOCKED)
+        cur->voluntary_switches++;
+      else if (cur->status == THREAD_READY)
+        cur->involuntary_switches++;
+      if (!is_idle_thread (next))
+        next->ready_ticks += timer_ticks () - next->ready_since;
+
+      trace (TRACE_SCHEDULE, cur->tid, next->tid);
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
@@ -692,142 +1164,92 @@ int
 thread_check_idle(void)
 {
   struct thread *cur = thread_current ();
-  if(cur == idle_thread) return 1;
+  if(is_idle_thread(cur)) return 1;
   else return 0;
 }
 
-/*list_sleep_thread의 ticks가 작은 순서대로 삽입
-list.c의 list_insert_ordered 사용 */
-//list_insert_ordered (struct list *list, struct list_elem *elem, list_less_func *less, void *aux)
-
-bool
-compare_tick(const struct list_elem *a, const struct list_elem *b, void *aux)
-{
-  //a 가 b보다 작으면 true, 아니면 false
-  struct thread *A = list_entry(a, struct thread, elem);
-  struct thread *B = list_entry(b, struct thread, elem);
-  if(A->wakeup_tick < B->wakeup_tick)
-  {
-    return true;
-  }
-  else return false;
-
-}
-void insert_sleep_thread()
-{
-  struct thread *cur = thread_current();
-  list_insert_ordered (&list_sleep_thread, &cur->elem, compare_tick, NULL);
-}
-
-void thread_awake(int64_t ticks)
-{
-  struct list_elem *element; //이 element로 리스트를 돌아가며 확인
-  struct thread *present_thread; //현재 element에 해당하는 thread 저장
-
-  for(element = list_begin(&list_sleep_thread) ; element != list_end(&list_sleep_thread) ; )
-  {
-    present_thread = list_entry(element, struct thread, elem);
-    if(present_thread -> wakeup_tick <= ticks) //현재 틱보다 wakeup tick이 작거나 같으면 sleep 리스트에서 제거하고 unblocking해야한다.
-    {
-      element = list_remove(element); //unblocking 후에 list_remove하면 오류발생. unblocking하면 ready list에 들어가 ready list에서 제거하기 때문이다.
-      thread_unblock(present_thread);
-    }
-    else break;
-  }
-}
-int64_t get_next_awake_tick()
-{
-  struct thread *first_thread;
-  first_thread = list_entry(list_begin(&list_sleep_thread), struct thread, elem);
-  //tick의 오름차순이므로 첫번째 원소가 최소 tick가지는 원소, 즉 next awake tick이다.
-  return first_thread-> wakeup_tick;
-}
-
 /* Offset of `stack' member within `struct thread'.
    Used by switch.S, which can't figure it out on its own. */
 uint32_t thread_stack_ofs = offsetof (struct thread, stack);
 
 
-// A function comparing threads priority
-// return true if t1's priority is higher than t2's
-bool thread_compare_priority(const struct list_elem *e1, const struct list_elem *e2, void *aux UNUSED) {
-  struct thread *t1 = list_entry(e1, struct thread, elem);
-  struct thread *t2 = list_entry(e2, struct thread, elem);
-  return (t1->priority > t2->priority);
-}
-
+// yield if a ready thread has higher priority than the current one.
+// sema_up() may call this from an interrupt handler, where we can
+// only ask for a yield on return from the interrupt.
+// under cfs, yield instead if a ready thread is far enough behind
+// the current one in vruntime.  real-time threads come before both.
 void check_list_preemption(void) {
-  if (list_empty(&ready_list)) return;
-  else {
-    struct thread *t_ready = list_entry(list_begin(&ready_list), struct thread, elem);
-    struct thread *t_cur = thread_current();
-    if(t_ready->priority > t_cur->priority) {
-      thread_yield();
-    }
-  }
-}
-
-// 다른 함수에서 호출할 때 t=thread_current(), depth=0으로 호출하도록 한다.
-void donate_priority(struct thread* t, int depth) {
-  struct thread* t_holder;
-  if(depth >= NESTED_DEPTH_MAX || t->lock_waiting_for==NULL)
-    return;
-  else {
-    t_holder = t->lock_waiting_for->holder;
-    // if current thread priority is higher than holder thread,
-    // donate current thread priority to holder thread
-    if (t->priority > t_holder->priority)
-      t_holder->priority = t->priority;
-    donate_priority(t_holder, depth+1); // for nested thread donation
-  }
-}
-
-
-void remove_with_lock(struct lock *lock) {
-  struct thread* t_cur = thread_current();
-  struct list_elem* cur_elem = list_begin(&(t_cur->donations));
-  struct thread* cur_elem_thread;
-  while(cur_elem!=list_end(&(t_cur->donations))) {
-    cur_elem_thread = list_entry(cur_elem, struct thread, donation_elem);
-    if(cur_elem_thread->lock_waiting_for == lock)
-      cur_elem = list_remove(cur_elem);
+  struct thread *cur = thread_current();
+  bool preempt;
+
+  if (rt_should_preempt(cur))
+    preempt = true;
+  else if (cur->rt)
+    preempt = false;
+  else if (thread_cfs)
+    preempt = cfs_should_preempt(cur);
+  else
+    preempt = ready_queue_max_priority() > cur->priority;
+  if (preempt) {
+    if (intr_context())
+      intr_yield_on_return();
     else
-      cur_elem = list_next(cur_elem);
+      thread_yield();
   }
 }
 
-// donations 리스트가 변화하였을 때 priority도 그에 따라 함께 변화하도록 한다.
-void refresh_priority(void) {
-  struct thread* t_cur = thread_current();
-  int origin_priority = t_cur->origin_priority;
-  int donations_max_priority = PRI_MIN - 1;
-  
-  // donations 리스트에서 가장 높은 priority가 origin_priority 보다 높은 경우
-  // 해당 priority를 갖도록 한다.
-  if(!list_empty(&(t_cur->donations))) {
-    donations_max_priority = (list_entry(list_max(&(t_cur->donations), thread_compare_priority, NULL), struct thread, donation_elem))->priority;
+// recompute t's priority from its own priority and the highest
+// priority waiting on a lock it holds, and carry the change along
+// the chain of locks that t (and then each holder) is waiting for.
+// the chain has no depth limit: the walk ends at the first thread
+// whose priority does not change.
+void refresh_priority(struct thread *t) {
+  enum intr_level old_level = intr_disable();
+
+  for (;;) {
+    int priority = t->origin_priority;
+    struct lock *lock;
+
+    if (!heap_empty(&t->held_locks)) {
+      struct lock *top = heap_entry(heap_top(&t->held_locks), struct lock, elem);
+      priority = max(priority, lock_donated_priority(top));
+    }
+    if (priority == t->priority)
+      break;
+    thread_set_effective_priority(t, priority);
+
+    // t's new priority changes its place among the waiters of the
+    // lock it wants, and so that lock's place among its holder's locks.
+    lock = t->lock_waiting_for;
+    if (lock == NULL)
+      break;
+    heap_update(&lock->waiters, &t->lock_elem);
+    if (lock->donee == NULL)
+      break;
+    heap_update(&lock->donee->held_locks, &lock->elem);
+    t = lock->donee;
   }
 
-  t_cur->priority = max(origin_priority, donations_max_priority);
+  intr_set_level(old_level);
 }
 
 
 /* Functions for Advanced Scheduler implementation */
 void mlfqs_priority(struct thread *t) {
-  int priority;
   // first, check if t is idle thread
-  if (t != idle_thread) {
-    // priority calculation part
-    // priority = PRI_MAX - (recent_cpu / 4) - (nice * 2)
-    priority = calc_priority(t->recent_cpu, t->nice);
-
-    if (priority < PRI_MIN)
-      t->priority = PRI_MIN;
-    else if (priority > PRI_MAX)
-      t->priority = PRI_MAX;
-    else
-      t->priority = priority;
-  }
+  if (!is_idle_thread(t))
+    thread_set_effective_priority(t, mlfqs_clamped_priority(t));
+}
+// priority = PRI_MAX - (recent_cpu / 4) - (nice * 2), clamped to [PRI_MIN, PRI_MAX]
+static int mlfqs_clamped_priority(struct thread *t) {
+  int priority = calc_priority(t->recent_cpu, t->nice);
+
+  if (priority < PRI_MIN)
+    return PRI_MIN;
+  else if (priority > PRI_MAX)
+    return PRI_MAX;
+  else
+    return priority;
 }
 int calc_priority(fixed_t _recent_cpu, int _nice) {
   // return priority = PRI_MAX - (recent_cpu / 4) - (nice * 2)
@@ -837,23 +1259,34 @@ int calc_priority(fixed_t _recent_cpu, int _nice) {
 }
 
 
+// decay t's recent_cpu by the coefficient of the current epoch.
+// t must be up to date with the previous epoch.
 void mlfqs_recent_cpu (struct thread *t) {
-  t->recent_cpu = calc_recent_cpu(load_avg, t->recent_cpu, t->nice);
+  ASSERT(t->decay_epoch == decay_epoch - 1);
+  t->recent_cpu = add_inf(t->nice, mul_f(decay_coef[decay_epoch % DECAY_HISTORY], t->recent_cpu));
+  t->decay_epoch = decay_epoch;
 }
 fixed_t calc_recent_cpu(fixed_t _load_avg, fixed_t _recent_cpu, int _nice) {
   // return recent_cpu = (2*load_avg)/(2*load_avg + 1) * recent_cpu + nice
-  return add_inf(_nice, mul_f(div_xby(mul_inf(2, _load_avg), add_inf(1, mul_inf(2, _load_avg))), _recent_cpu));
+  return add_inf(_nice, mul_f(calc_decay_coef(_load_avg), _recent_cpu));
+}
+fixed_t calc_decay_coef(fixed_t _load_avg) {
+  // return (2*load_avg)/(2*load_avg + 1)
+  return div_xby(mul_inf(2, _load_avg), add_inf(1, mul_inf(2, _load_avg)));
 }
 
 
 void mlfqs_load_avg(void) {
-  int num_ready_threads = list_size(&ready_list);
+  int num_ready_threads = ready_cnt;
   // ready_list 외에도 현재 실행 중인 thread가 idle thread가 아닌 경우,
   // load_avg의 계산을 위해 포함해야 한다.
+  // real-time threads are left out, as they are of ready_cnt.
   struct thread *t_cur = thread_current();
-  if(t_cur != idle_thread) num_ready_threads++;
+  if(!is_idle_thread(t_cur) && !t_cur->rt) num_ready_threads++;
   
+  seqlock_write_begin(&load_avg_seqlock);
   load_avg = calc_load_avg(load_avg, num_ready_threads);
+  seqlock_write_end(&load_avg_seqlock);
 }
 fixed_t calc_load_avg(fixed_t _load_avg, int _ready_threads) {
   // return load_avg = (59/60)*load_avg + (1/60)*ready_threads
@@ -863,31 +1296,363 @@ fixed_t calc_load_avg(fixed_t _load_avg, int _ready_threads) {
 
 void mlfqs_recent_cpu_incr(void) {
   struct thread *t_cur = thread_current();
-  // check if current thread is idle_thread,
+  // check if current thread is idle_thread or real-time,
   // if not, increase recent_cpu value of current thread by 1
-  if (t_cur!=idle_thread)
+  if (!is_idle_thread(t_cur) && !t_cur->rt)
     t_cur->recent_cpu = add_inf(1, t_cur->recent_cpu);
 }
 
 
-// recalculate recent_cpu and priority of all threads
+// recalculate recent_cpu and priority of the runnable threads.
+// blocked threads are caught up lazily by mlfqs_catch_up(), except
+// those whose last decay is about to fall out of decay_coef[].
 void mlfqs_update_all(void) {
-  mlfqs_update_all_recent_cpu();
-  mlfqs_update_all_priority();
-}
-void mlfqs_update_all_recent_cpu(void) {
-  struct list_elem* elem=list_begin(&all_list);
-  while(elem!=list_end(&all_list)) {
-    mlfqs_recent_cpu(list_entry(elem, struct thread, allelem));
-    elem = list_next(elem);
+  struct thread *t_cur = thread_current();
+  struct list runnable;
+  int pri;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  decay_epoch++;
+  decay_coef[decay_epoch % DECAY_HISTORY] = calc_decay_coef(load_avg);
+
+  // take every ready thread out of the run queue, highest priority
+  // first and FIFO within a priority, so that requeueing them in
+  // this order below keeps equal-priority threads in their old order.
+  // ready real-time threads stay in rt_queue.
+  list_init(&runnable);
+  for (pri = PRI_MAX; pri >= PRI_MIN; pri--)
+    while (!list_empty(&ready_queues[pri])) {
+      list_push_back(&runnable, list_pop_front(&ready_queues[pri]));
+      ready_cnt--;
+    }
+  ready_bitmap = 0;
+
+  while (!list_empty(&runnable)) {
+    struct thread *t = list_entry(list_pop_front(&runnable), struct thread, elem);
+    mlfqs_recent_cpu(t);
+    t->priority = mlfqs_clamped_priority(t);
+    ready_queue_push(t);
+  }
+
+  // real-time threads keep their priority and never decay.
+  if (!is_idle_thread(t_cur) && !t_cur->rt) {
+    mlfqs_recent_cpu(t_cur);
+    mlfqs_priority(t_cur);
+  }
+
+  // catch up blocked threads that would otherwise miss a coefficient.
+  while (!list_empty(&decay_list)) {
+    struct thread *t = list_entry(list_front(&decay_list), struct thread, decay_elem);
+    if (decay_epoch - t->decay_epoch < DECAY_HISTORY)
+      break;
+    mlfqs_refresh(t);
+  }
+}
+
+// returns the number of one-second mlfqs updates so far.  a blocked
+// thread's priority only goes stale when this changes.
+int mlfqs_decay_epoch(void) {
+  return decay_epoch;
+}
+
+// bring blocked thread t's recent_cpu and priority up to date.  a
+// thread waiting on a semaphore or condition variable moves to its
+// new place among the waiters, see thread_set_effective_priority().
+void mlfqs_refresh(struct thread *t) {
+  enum intr_level old_level = intr_disable();
+
+  if (t->status == THREAD_BLOCKED && !t->rt && t->decay_epoch != decay_epoch) {
+    mlfqs_catch_up(t);
+    // t's epoch is now the newest, so it moves to the back of decay_list.
+    decay_list_remove(t);
+    mlfqs_park(t);
   }
+  intr_set_level(old_level);
 }
-void mlfqs_update_all_priority(void) {
-  struct list_elem* elem=list_begin(&all_list);
-  while(elem!=list_end(&all_list)) {
-    mlfqs_priority(list_entry(elem, struct thread, allelem));
-    elem = list_next(elem);
+
+// replay the decays t missed while blocked.  recent_cpu == nice == 0
+// is a fixed point of the decay, so such threads only need their
+// priority recomputed, as mlfqs_update_all() would have done.
+static void mlfqs_catch_up(struct thread *t) {
+  if (t->decay_epoch == decay_epoch)
+    return;
+
+  if (t->recent_cpu != 0 || t->nice != 0) {
+    ASSERT(decay_epoch - t->decay_epoch <= DECAY_HISTORY);
+    while (t->decay_epoch != decay_epoch) {
+      t->decay_epoch++;
+      t->recent_cpu = add_inf(t->nice, mul_f(decay_coef[t->decay_epoch % DECAY_HISTORY], t->recent_cpu));
+    }
   }
-  // after update all, should sort ready_list for new updated priority
-  list_sort(&ready_list, thread_compare_priority, NULL);
-}
\ No newline at end of file
+  t->decay_epoch = decay_epoch;
+  mlfqs_priority(t);
+}
+
+// called as t blocks: put t on decay_list unless it is at the fixed point.
+static void mlfqs_park(struct thread *t) {
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (is_idle_thread(t))
+    return;
+  ASSERT(!t->decaying);
+  ASSERT(t->decay_epoch == decay_epoch);
+  if (t->recent_cpu == 0 && t->nice == 0)
+    return;
+  list_push_back(&decay_list, &t->decay_elem);
+  t->decaying = true;
+}
+
+static void decay_list_remove(struct thread *t) {
+  if (t->decaying) {
+    list_remove(&t->decay_elem);
+    t->decaying = false;
+  }
+}
+
+
+/* Functions for the completely fair scheduler */
+
+/* Orders threads by vruntime for cfs_tree. */
+bool
+thread_vruntime_less (const struct rb_node *a_, const struct rb_node *b_,
+                      void *aux UNUSED)
+{
+  const struct thread *a = rb_entry (a_, struct thread, cfs_node);
+  const struct thread *b = rb_entry (b_, struct thread, cfs_node);
+
+  return a->vruntime < b->vruntime;
+}
+
+/* Returns T's share of the CPU relative to other threads. */
+static unsigned
+cfs_weight (const struct thread *t)
+{
+  int nice = t->nice;
+
+  if (nice < NICE_MIN)
+    nice = NICE_MIN;
+  else if (nice > NICE_MAX)
+    nice = NICE_MAX;
+  return cfs_weights[nice - NICE_MIN];
+}
+
+/* Advances min_vruntime to the least vruntime among the running
+   and ready threads, if that is larger. */
+static void
+cfs_update_min_vruntime (void)
+{
+  struct thread *cur = thread_current ();
+  struct rb_node *first = rb_first (&cfs_tree);
+  bool found = false;
+  int64_t vruntime = 0;
+
+  if (!is_idle_thread (cur) && !cur->rt && cur->status == THREAD_RUNNING)
+    {
+      vruntime = cur->vruntime;
+      found = true;
+    }
+  if (first != NULL)
+    {
+      int64_t first_vruntime = rb_entry (first, struct thread,
+                                         cfs_node)->vruntime;
+      if (!found || first_vruntime < vruntime)
+        vruntime = first_vruntime;
+      found = true;
+    }
+  if (found && vruntime > min_vruntime)
+    min_vruntime = vruntime;
+}
+
+/* Places T, which is waking up, in vruntime order.  A thread
+   that slept does not bank the CPU time it did not use: it comes
+   back at most CFS_SLEEPER_CREDIT behind min_vruntime, enough to
+   run soon but not to starve the others.  Interrupts must be
+   off. */
+static void
+cfs_place (struct thread *t)
+{
+  int64_t floor;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  cfs_update_min_vruntime ();
+  floor = min_vruntime - CFS_SLEEPER_CREDIT;
+  if (t->vruntime < floor)
+    t->vruntime = floor;
+}
+
+/* Charges the timer tick to T, the running thread.  Returns true
+   if T has used up its slice, which is its weight's share of
+   CFS_LATENCY among the ready threads, but no less than
+   CFS_MIN_GRANULARITY. */
+static bool
+cfs_tick (struct thread *t)
+{
+  unsigned weight = cfs_weight (t);
+  unsigned slice;
+
+  ASSERT (intr_context ());
+
+  t->vruntime += CFS_TICK_VRUNTIME * CFS_NICE_0_WEIGHT / weight;
+  cfs_update_min_vruntime ();
+
+  slice = CFS_LATENCY * weight / (cfs_load + weight);
+  if (slice < CFS_MIN_GRANULARITY)
+    slice = CFS_MIN_GRANULARITY;
+  return ++thread_ticks >= slice && !rb_empty (&cfs_tree);
+}
+
+/* Returns true if the leftmost ready thread is far enough behind
+   CUR in vruntime that it should run now. */
+static bool
+cfs_should_preempt (struct thread *cur)
+{
+  struct rb_node *first;
+  bool preempt = false;
+  enum intr_level old_level = intr_disable ();
+
+  first = rb_first (&cfs_tree);
+  if (first != NULL)
+    preempt = (is_idle_thread (cur)
+               || (cur->vruntime
+                   - rb_entry (first, struct thread, cfs_node)->vruntime
+                   > CFS_WAKEUP_GRANULARITY));
+  intr_set_level (old_level);
+  return preempt;
+}
+
+
+/* Functions for the real-time scheduler */
+
+/* Orders real-time threads for rt_queue, so that the one
+   with the earliest deadline is on top. */
+bool
+thread_deadline_less (const struct heap_elem *a_, const struct heap_elem *b_,
+                      void *aux UNUSED)
+{
+  const struct thread *a = heap_entry (a_, struct thread, rt_elem);
+  const struct thread *b = heap_entry (b_, struct thread, rt_elem);
+
+  return a->rt_deadline > b->rt_deadline;
+}
+
+/* Admission test: reserves BUDGET / PERIOD of the CPU, storing
+   the reserved share in *UTIL, and returns true, unless that
+   would take the total reserved for real-time threads above 1,
+   in which case returns false. */
+static bool
+rt_admit (int64_t period, int64_t budget, unsigned *util)
+{
+  enum intr_level old_level;
+  bool admitted;
+
+  *util = ((uint64_t) budget * RT_UTIL_ONE + period - 1) / period;
+
+  old_level = intr_disable ();
+  admitted = *util <= RT_UTIL_ONE - rt_util;
+  if (admitted)
+    {
+      rt_util += *util;
+      rt_thread_cnt++;
+    }
+  intr_set_level (old_level);
+  return admitted;
+}
+
+/* Gives back a share of the CPU reserved by rt_admit(). */
+static void
+rt_release (unsigned util)
+{
+  enum intr_level old_level = intr_disable ();
+  ASSERT (rt_util >= util);
+  rt_util -= util;
+  intr_set_level (old_level);
+}
+
+/* Starts a new period for real-time thread T at tick START, with
+   a full budget. */
+static void
+rt_start_period (struct thread *t, int64_t start)
+{
+  t->rt_deadline = start + t->rt_period;
+  t->rt_runtime = t->rt_budget;
+}
+
+/* Called as real-time thread T wakes up.  T keeps its deadline
+   and what is left of its budget only if running out the budget
+   by the deadline stays within T's share of the CPU; otherwise,
+   which includes every wakeup after the period has ended, T
+   starts a new period now.  Without this, a thread that sleeps
+   until just before its deadline could claim its whole budget in
+   the little time left and crowd out the others. */
+static void
+rt_wakeup (struct thread *t)
+{
+  int64_t now = timer_ticks ();
+
+  if (now >= t->rt_deadline
+      || t->rt_runtime * t->rt_period > (t->rt_deadline - now) * t->rt_budget)
+    rt_start_period (t, now);
+}
+
+/* Charges the timer tick to T, the running real-time thread.
+   Returns true if T must yield the CPU, either because it has
+   used up its budget and is now throttled until its period ends,
+   or because its period ended while it still had budget left,
+   which is a deadline miss and gives T a later deadline. */
+static bool
+rt_tick (struct thread *t)
+{
+  int64_t now = timer_ticks ();
+
+  t->rt_runtime--;
+  if (now >= t->rt_deadline)
+    {
+      if (t->rt_runtime > 0)
+        rt_miss_cnt++;
+      rt_start_period (t, now);
+      return true;
+    }
+  if (t->rt_runtime > 0)
+    return false;
+
+  t->rt_throttled = true;
+  rt_throttle_cnt++;
+  timer_add (&t->rt_timer, rt_replenish, t, t->rt_deadline);
+  return true;
+}
+
+/* Timer callback that ends the throttling of real-time thread T
+   at the end of its period and gives it a new budget. */
+static void
+rt_replenish (void *t_)
+{
+  struct thread *t = t_;
+
+  ASSERT (t->rt_throttled);
+  ASSERT (t->status == THREAD_READY);
+
+  rt_start_period (t, t->rt_deadline);
+  t->rt_throttled = false;
+  ready_queue_push (t);
+  check_list_preemption ();
+}
+
+/* Returns true if a real-time thread in the run queue should run
+   instead of CUR. */
+static bool
+rt_should_preempt (struct thread *cur)
+{
+  struct heap_elem *top;
+  bool preempt = false;
+  enum intr_level old_level = intr_disable ();
+
+  top = heap_top (&rt_queue);
+  if (top != NULL)
+    preempt = (!cur->rt
+               || (heap_entry (top, struct thread, rt_elem)->rt_deadline
+                   < cur->rt_deadline));
+  intr_set_level (old_level);
+  return preempt;
+}
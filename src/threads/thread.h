@@ -2,9 +2,14 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <hash.h>
+#include <heap.h>
 #include <list.h>
+#include <rbtree.h>
 #include <stdint.h>
+#include "devices/timer.h"
 
+struct rwlock;
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -25,8 +30,9 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
-/* Priority donation values */
-#define NESTED_DEPTH_MAX 8
+/* Most readers-writer locks a thread may hold for reading at
+   once. */
+#define RWLOCK_READ_MAX 4
 
 
 /* A kernel thread or user process.
@@ -79,12 +85,11 @@ typedef int tid_t;
    the `magic' member of the running thread's `struct thread' is
    set to THREAD_MAGIC.  Stack overflow will normally change this
    value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+/* The `elem' member is an element in the run queue (thread.c).
+   A thread waiting on a semaphore or condition variable is
+   instead in that object's waiters heap through `wait_elem'
+   (synch.c), which stays ordered as the thread's priority
+   changes. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -94,44 +99,118 @@ struct thread
     uint8_t *stack;                     /* Saved stack pointer. */
     int priority;                       /* Priority. */
     struct list_elem allelem;           /* List element for all threads list. */
-    
-    int64_t wakeup_tick;                /* save tick for wake up */
+
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
+    struct heap *wait_queue;            /* Waiters heap we are in, or NULL. */
+    struct heap_elem wait_elem;         /* Element in wait_queue. */
+    unsigned wait_seq;                  /* Arrival order among waiters. */
+
+    /* Owned by synch.c. */
+    struct rwlock *read_locks[RWLOCK_READ_MAX]; /* Held for reading. */
+    int read_lock_cnt;                  /* Number of read_locks in use. */
 
     /* For donation implementation */
     /* Some of them must be initialized in init_thread() */
     int origin_priority;                /* original priority for initialization after donation */
     struct lock *lock_waiting_for;      /* the lock Thread waiting for */
-    struct list donations;              /* for multiple donation : 자신에게 donate한 threads 목록 */ 
-    struct list_elem donation_elem;     /* for multiple donation : 자신에게 donate한 thread element*/
+    struct heap held_locks;             /* locks donating to us, by priority of their top waiter */
+    struct heap_elem lock_elem;         /* element in lock_waiting_for's waiters heap */
 
     /* For Advanced Scheduler implementation */
     int nice;
     int recent_cpu;
+    int decay_epoch;                    /* mlfqs epoch of the last recent_cpu decay */
+    bool decaying;                      /* whether decay_elem is in the lazy decay list */
+    struct list_elem decay_elem;        /* element of the lazy decay list */
+
+    /* Completely fair scheduler (thread_cfs). */
+    int64_t vruntime;                   /* Run time, weighted by nice. */
+    struct rb_node cfs_node;            /* Element in cfs_tree. */
+
+    /* Earliest-deadline-first real-time class (thread_create_rt()). */
+    bool rt;                            /* Real-time thread? */
+    int64_t rt_period;                  /* Period, in timer ticks. */
+    int64_t rt_budget;                  /* Run time per period, in ticks. */
+    int64_t rt_deadline;                /* End of the current period. */
+    int64_t rt_runtime;                 /* Budget left in this period. */
+    bool rt_throttled;                  /* Out of budget until rt_deadline? */
+    unsigned rt_util;                   /* Admitted share of the CPU. */
+    struct timer rt_timer;              /* Ends throttling. */
+    struct heap_elem rt_elem;           /* Element in rt_queue. */
+
+    /* Statistics, see thread_stats().  Times are in timer ticks. */
+    long long user_ticks;               /* Time running user code. */
+    long long kernel_ticks;             /* Time running in the kernel. */
+    long long voluntary_switches;       /* # of times we blocked. */
+    long long involuntary_switches;     /* # of times we were preempted. */
+    long long ready_ticks;              /* Time spent in THREAD_READY. */
+    long long lock_ticks;               /* Time spent waiting for locks. */
+    int64_t ready_since;                /* When we last became ready. */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
+    int exit_status;                    /* Status passed to exit(). */
+    struct child *child;                /* Shared with parent, or null. */
+    struct list children;               /* Our children's struct child. */
+
+    /* Owned by userprog/syscall.c. */
+    struct list files;                  /* Open files. */
+    int next_fd;                        /* Handle for the next one. */
+    void *syscall_esp;                  /* User %esp at system call. */
+#ifdef VM
+    struct hash pages;                  /* Supplemental page table. */
+    struct file *exec_file;             /* Executable, kept open. */
+    struct list mappings;               /* Memory-mapped files. */
+    int next_mapid;                     /* Identifier for the next one. */
+#endif
 #endif
 
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
   };
 
+/* Snapshot of a thread's statistics, taken by thread_stats(). */
+struct thread_stats
+  {
+    tid_t tid;                          /* Thread identifier. */
+    char name[16];                      /* Name. */
+    enum thread_status status;          /* State when taken. */
+    int priority;                       /* Effective priority. */
+    int nice;                           /* Nice value. */
+    long long user_ticks;               /* Time running user code. */
+    long long kernel_ticks;             /* Time running in the kernel. */
+    long long voluntary_switches;       /* # of times blocked. */
+    long long involuntary_switches;     /* # of times preempted. */
+    long long ready_ticks;              /* Time spent ready to run. */
+    long long lock_ticks;               /* Time spent waiting for locks. */
+  };
+
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler, which ignores
+   priorities and shares the CPU in proportion to a weight
+   derived from each thread's nice value.
+   Controlled by kernel command-line option "-sched=cfs". */
+extern bool thread_cfs;
+
 void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
+void thread_add_idle_ticks (int64_t cnt);
 void thread_print_stats (void);
+size_t thread_stats (struct thread_stats *, size_t max);
+const char *thread_status_name (enum thread_status);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
+tid_t thread_create_rt (const char *name, int64_t period, int64_t budget,
+                        thread_func *, void *);
 
 void thread_block (void);
 void thread_unblock (struct thread *);
@@ -157,17 +236,10 @@ int thread_get_load_avg (void);
 
 // alarm clock
 int thread_check_idle(void);
-list_less_func compare_tick;
-void insert_sleep_thread();
-void thread_awake(int64_t ticks);
-int64_t get_next_awake_tick(void);
 
 // priority scheduler
-bool thread_compare_priority(const struct list_elem *e1, const struct list_elem *e2, void *aux UNUSED);
 void check_list_preemption(void);
-void donate_priority(struct thread* t, int depth);
-void remove_with_lock(struct lock *lock);
-void refresh_priority(void);
+void refresh_priority(struct thread *t);
 void mlfqs_priority(struct thread *t);
 int calc_priority(int _recent_cpu, int _nice);
 void mlfqs_recent_cpu (struct thread *t);
@@ -176,7 +248,13 @@ void mlfqs_load_avg(void);
 int calc_load_avg(int _load_avg, int _ready_threads);
 void mlfqs_recent_cpu_incr(void);
 void mlfqs_update_all(void);
-void mlfqs_update_all_recent_cpu(void);
-void mlfqs_update_all_priority(void);
+void mlfqs_refresh(struct thread *t);
+int mlfqs_decay_epoch(void);
+
+// completely fair scheduler
+rb_less_func thread_vruntime_less;
+
+// real-time scheduler
+heap_less_func thread_deadline_less;
 
 #endif /* threads/thread.h */
@@ -0,0 +1,169 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Pages in the ring buffer. */
+#define RING_PAGES 16
+#define RING_SIZE (RING_PAGES * PGSIZE / sizeof (struct trace_record))
+
+/* Ring of trace records.  It is written with interrupts off for
+   the few instructions it takes, so no lock is needed even
+   though tracepoints fire in interrupt handlers and in the middle
+   of schedule(). */
+static struct trace_record *records;    /* RING_SIZE records. */
+static size_t head;                     /* Next slot to write. */
+static unsigned long long record_cnt;   /* Total # of records written. */
+
+/* -trace: Is tracing on? */
+bool trace_enabled;
+
+/* Allocates the ring buffer, if tracing was requested on the
+   command line.  Tracepoints that fire earlier are ignored. */
+void
+trace_init (void)
+{
+  if (!trace_enabled)
+    return;
+
+  trace_enabled = false;
+  records = palloc_get_multiple (PAL_ASSERT, RING_PAGES);
+  trace_enabled = true;
+}
+
+/* Returns the tid of the thread whose stack we are on.  This is
+   running_thread() in thread.c without its sanity checks, which
+   do not hold in schedule() while a context switch is
+   underway. */
+static tid_t
+current_tid (void) 
+{
+  uint32_t *esp;
+
+  asm ("mov %%esp, %0" : "=g" (esp));
+  return ((struct thread *) pg_round_down (esp))->tid;
+}
+
+/* Appends EVENT with ARG0 and ARG1 to the ring.
+   Call through trace(), which first checks whether tracing is
+   on. */
+void
+trace_record (enum trace_event event, uint32_t arg0, uint32_t arg1)
+{
+  enum intr_level old_level;
+  struct trace_record *rec;
+
+  ASSERT (event < TRACE_EVENT_CNT);
+
+  old_level = intr_disable ();
+  rec = &records[head];
+  if (++head >= RING_SIZE)
+    head = 0;
+  record_cnt++;
+
+  rec->time = timer_now_ns ();
+  rec->event = event;
+  rec->cpu = 0;
+  rec->tid = current_tid ();
+  rec->arg0 = arg0;
+  rec->arg1 = arg1;
+  intr_set_level (old_level);
+}
+
+/* Buffer for writing a dump sector by sector. */
+struct dump
+  {
+    struct block *block;                /* Device to write. */
+    block_sector_t sector;              /* Next sector to write. */
+    size_t ofs;                         /* Bytes used in BUF. */
+    uint8_t buf[BLOCK_SECTOR_SIZE];
+  };
+
+/* Writes out D's partial sector, padding it with zeros. */
+static void
+dump_flush (struct dump *d) 
+{
+  if (d->ofs == 0)
+    return;
+  if (d->sector >= block_size (d->block))
+    PANIC ("trace-dump: out of space on %s", block_name (d->block));
+  memset (d->buf + d->ofs, 0, sizeof d->buf - d->ofs);
+  block_write (d->block, d->sector++, d->buf);
+  d->ofs = 0;
+}
+
+/* Appends the SIZE bytes in DATA to D. */
+static void
+dump_write (struct dump *d, const void *data_, size_t size) 
+{
+  const uint8_t *data = data_;
+
+  while (size > 0) 
+    {
+      size_t chunk = sizeof d->buf - d->ofs;
+      if (chunk > size)
+        chunk = size;
+      memcpy (d->buf + d->ofs, data, chunk);
+      d->ofs += chunk;
+      data += chunk;
+      size -= chunk;
+      if (d->ofs == sizeof d->buf)
+        dump_flush (d);
+    }
+}
+
+/* Writes the contents of the trace ring to BLOCK, starting at
+   its first sector, in the format described in trace.h.
+   Tracing stops while the dump is being written, so that the
+   dump's own disk writes do not overwrite the trace. */
+void
+trace_dump (struct block *block) 
+{
+  static struct dump d;
+  struct trace_header h;
+  unsigned long long lost = 0;
+  size_t total = record_cnt;
+  bool was_enabled = trace_enabled;
+
+  ASSERT (block != NULL);
+
+  trace_enabled = false;
+  if (record_cnt > RING_SIZE)
+    {
+      lost = record_cnt - RING_SIZE;
+      total = RING_SIZE;
+    }
+
+  d.block = block;
+  d.sector = 0;
+  d.ofs = 0;
+
+  memset (&h, 0, sizeof h);
+  memcpy (h.magic, TRACE_MAGIC, sizeof h.magic);
+  h.version = TRACE_VERSION;
+  h.record_size = sizeof (struct trace_record);
+  h.record_cnt = total;
+  h.lost_cnt = lost;
+  dump_write (&d, &h, sizeof h);
+  dump_flush (&d);
+
+  if (record_cnt > RING_SIZE)
+    {
+      /* Wrapped around: the oldest record is at the head. */
+      dump_write (&d, records + head, (RING_SIZE - head) * sizeof *records);
+      dump_write (&d, records, head * sizeof *records);
+    }
+  else
+    dump_write (&d, records, total * sizeof *records);
+  dump_flush (&d);
+
+  printf ("Dumped %zu trace records (%llu lost) to %s.\n",
+          total, lost, block_name (block));
+  trace_enabled = was_enabled;
+}
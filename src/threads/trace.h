@@ -0,0 +1,77 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct block;
+
+/* Kernel event tracing.
+
+   Tracepoints compiled into the kernel append fixed-size binary
+   records to a ring buffer, which keeps the most recent events.
+   Unlike printf(), a tracepoint does not touch the console or
+   the serial port, so it barely perturbs timing.
+   Tracing is off unless the kernel is run with -trace.  The
+   "trace-dump" action writes the ring to the scratch device,
+   and utils/trace2json converts the dump into Chrome's trace
+   event format, for viewing in chrome://tracing or Perfetto. */
+
+/* Events.  The dump format depends on these values, so add new
+   events only at the end, and keep utils/trace2json.c in
+   sync. */
+enum trace_event
+  {
+    TRACE_SCHEDULE,             /* Context switch: prev tid, next tid. */
+    TRACE_THREAD_BLOCK,         /* thread_block(): caller. */
+    TRACE_THREAD_UNBLOCK,       /* thread_unblock(): tid, priority. */
+    TRACE_SEMA_DOWN,            /* sema_down(): semaphore, value. */
+    TRACE_SEMA_UP,              /* sema_up(): semaphore, value. */
+    TRACE_INTR_ENTER,           /* Interrupt: vector, eip. */
+    TRACE_INTR_EXIT,            /* End of interrupt: vector. */
+    TRACE_BLOCK_READ,           /* block_read(): block type, sector. */
+    TRACE_BLOCK_WRITE,          /* block_write(): block type, sector. */
+    TRACE_PAGE_FAULT,           /* Page fault: address, error code. */
+    TRACE_EVENT_CNT
+  };
+
+/* A trace record, as stored in memory and in a dump. */
+struct trace_record
+  {
+    uint64_t time;              /* timer_now_ns() when recorded. */
+    uint16_t event;             /* An enum trace_event. */
+    uint16_t cpu;               /* CPU that recorded it, always 0. */
+    int32_t tid;                /* Thread running on that CPU. */
+    uint32_t arg0, arg1;        /* Event-specific arguments. */
+  };
+
+/* First sector of a dump, followed by the records, oldest first,
+   packed end to end across sectors. */
+#define TRACE_MAGIC "PINTRACE"
+#define TRACE_VERSION 1
+struct trace_header
+  {
+    char magic[8];              /* TRACE_MAGIC, without a null. */
+    uint32_t version;           /* TRACE_VERSION. */
+    uint32_t record_size;       /* sizeof (struct trace_record). */
+    uint32_t record_cnt;        /* Number of records in the dump. */
+    uint32_t lost_cnt;          /* Older records overwritten. */
+  };
+
+/* -trace: Is tracing on? */
+extern bool trace_enabled;
+
+void trace_init (void);
+void trace_record (enum trace_event, uint32_t arg0, uint32_t arg1);
+void trace_dump (struct block *);
+
+/* Tracepoint.  Records EVENT with arguments ARG0 and ARG1, if
+   tracing is on.  Costs a single test otherwise. */
+static inline void
+trace (enum trace_event event, uint32_t arg0, uint32_t arg1)
+{
+  if (trace_enabled)
+    trace_record (event, arg0, arg1);
+}
+
+#endif /* threads/trace.h */
@@ -4,6 +4,10 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -142,12 +146,34 @@ page_fault (struct intr_frame *f)
 
   /* Count page faults. */
   page_fault_cnt++;
+  trace (TRACE_PAGE_FAULT, (uintptr_t) fault_addr, f->error_code);
 
   /* Determine cause. */
   not_present = (f->error_code & PF_P) == 0;
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+#ifdef VM
+  /* A page of the process's address space that has not been
+     touched yet.  The kernel may fault on one too, while
+     accessing user memory on the process's behalf. */
+  if (not_present && page_load (fault_addr))
+    return;
+
+  /* A push or a stack access just below the stack pointer.  In
+     a system call the kernel sees its own %esp, so use the
+     process's from when it made the call. */
+  if (not_present
+      && page_grow_stack (fault_addr, user ? f->esp
+                                           : thread_current ()->syscall_esp)
+      && page_load (fault_addr))
+    return;
+
+  /* A write to a page still shared with a parent or child. */
+  if (!not_present && write && page_unshare (fault_addr))
+    return;
+#endif
+
   /* To implement virtual memory, delete the rest of the function
      body, and replace it with code that brings in the page to
      which fault_addr refers. */
@@ -156,6 +156,36 @@ pagedir_clear_page (uint32_t *pd, void *upage)
     }
 }
 
+/* Makes the mapping for user virtual page UPAGE in PD writable
+   by the user process if WRITABLE is true, read-only otherwise.
+   Other bits in the page table entry are preserved.
+   UPAGE need not be mapped. */
+void
+pagedir_set_writable (uint32_t *pd, const void *upage, bool writable) 
+{
+  uint32_t *pte = lookup_page (pd, upage, false);
+  if (pte != NULL) 
+    {
+      if (writable)
+        *pte |= PTE_W;
+      else 
+        {
+          *pte &= ~(uint32_t) PTE_W;
+          invalidate_pagedir (pd);
+        }
+    }
+}
+
+/* Returns true if the PTE for virtual page VPAGE in PD is
+   present and writable by the user process.
+   Returns false if PD contains no PTE for VPAGE. */
+bool
+pagedir_is_writable (uint32_t *pd, const void *vpage) 
+{
+  uint32_t *pte = lookup_page (pd, vpage, false);
+  return pte != NULL && (*pte & (PTE_P | PTE_W)) == (PTE_P | PTE_W);
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PD is dirty,
    that is, if the page has been modified since the PTE was
    installed.
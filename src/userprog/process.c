@@ -14,43 +14,144 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "userprog/syscall.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#endif
+
+/* A child process's exit status, shared between the child and
+   its parent so that it outlives whichever of the two exits
+   first. */
+struct child
+  {
+    struct list_elem elem;      /* Element in parent's `children'. */
+    tid_t tid;                  /* Child's thread identifier. */
+    int exit_status;            /* Set when DEAD is upped. */
+    struct semaphore dead;      /* Upped when the child exits. */
+    int ref_cnt;                /* Parent and child, while alive. */
+  };
+
+/* Passed from process_execute() to start_process(). */
+struct exec_info
+  {
+    char *cmd_line;             /* Program name and arguments. */
+    struct child *child;        /* Exit status for the parent. */
+    struct semaphore loaded;    /* Upped when the load is done. */
+    bool success;               /* Did it succeed? */
+  };
 
 static thread_func start_process NO_RETURN;
-static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static bool load (const char *cmd_line, void (**eip) (void), void **esp);
 
-/* Starts a new thread running a user program loaded from
-   FILENAME.  The new thread may be scheduled (and may even exit)
-   before process_execute() returns.  Returns the new process's
-   thread id, or TID_ERROR if the thread cannot be created. */
+/* Returns a new struct child, referenced by both a parent and a
+   child that is yet to be created, or a null pointer if memory
+   is short. */
+static struct child *
+child_create (void) 
+{
+  struct child *c = malloc (sizeof *c);
+  if (c != NULL) 
+    {
+      c->tid = TID_ERROR;
+      c->exit_status = -1;
+      sema_init (&c->dead, 0);
+      c->ref_cnt = 2;
+    }
+  return c;
+}
+
+/* Drops a reference to C, freeing it when the parent and the
+   child are both done with it. */
+static void
+child_release (struct child *c) 
+{
+  enum intr_level old_level;
+  bool last;
+
+  old_level = intr_disable ();
+  last = --c->ref_cnt == 0;
+  intr_set_level (old_level);
+  if (last)
+    free (c);
+}
+
+/* Copies the first word of CMD_LINE, the name of the program to
+   run, into NAME, truncating it to SIZE - 1 characters. */
+static void
+program_name (const char *cmd_line, char *name, size_t size) 
+{
+  size_t len;
+
+  cmd_line += strspn (cmd_line, " ");
+  len = strcspn (cmd_line, " ");
+  strlcpy (name, cmd_line, len < size ? len + 1 : size);
+}
+
+/* Starts a new thread running a user program loaded as
+   described by CMD_LINE, the program's name followed by its
+   arguments, separated by spaces.  The new thread may be
+   scheduled (and may even exit) before process_execute()
+   returns.  Returns the new process's thread id, or TID_ERROR if
+   the thread cannot be created or the program cannot be
+   loaded. */
 tid_t
-process_execute (const char *file_name) 
+process_execute (const char *cmd_line) 
 {
-  char *fn_copy;
+  struct thread *cur = thread_current ();
+  struct exec_info info;
+  char name[sizeof cur->name];
   tid_t tid;
 
-  /* Make a copy of FILE_NAME.
+  /* Make a copy of CMD_LINE.
      Otherwise there's a race between the caller and load(). */
-  fn_copy = palloc_get_page (0);
-  if (fn_copy == NULL)
+  info.cmd_line = palloc_get_page (0);
+  if (info.cmd_line == NULL)
     return TID_ERROR;
-  strlcpy (fn_copy, file_name, PGSIZE);
+  strlcpy (info.cmd_line, cmd_line, PGSIZE);
+  info.child = child_create ();
+  if (info.child == NULL) 
+    {
+      palloc_free_page (info.cmd_line);
+      return TID_ERROR;
+    }
+  sema_init (&info.loaded, 0);
+  info.success = false;
+
+  /* Create a new thread to execute CMD_LINE, and wait to find
+     out whether it could be loaded. */
+  program_name (cmd_line, name, sizeof name);
+  tid = thread_create (name, PRI_DEFAULT, start_process, &info);
+  if (tid != TID_ERROR)
+    sema_down (&info.loaded);
+  palloc_free_page (info.cmd_line);
 
-  /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (file_name, PRI_DEFAULT, start_process, fn_copy);
   if (tid == TID_ERROR)
-    palloc_free_page (fn_copy); 
+    free (info.child);
+  else if (!info.success) 
+    {
+      child_release (info.child);
+      tid = TID_ERROR;
+    }
+  else 
+    {
+      info.child->tid = tid;
+      list_push_back (&cur->children, &info.child->elem);
+    }
   return tid;
 }
 
 /* A thread function that loads a user process and starts it
    running. */
 static void
-start_process (void *file_name_)
+start_process (void *info_)
 {
-  char *file_name = file_name_;
+  struct exec_info *info = info_;
   struct intr_frame if_;
   bool success;
 
@@ -59,10 +160,17 @@ start_process (void *file_name_)
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp);
+  lock_acquire (&filesys_lock);
+  success = load (info->cmd_line, &if_.eip, &if_.esp);
+  lock_release (&filesys_lock);
+
+  /* Tell our parent how it went.  INFO is on the parent's stack,
+     so it goes away as soon as the parent wakes up. */
+  thread_current ()->child = info->child;
+  info->success = success;
+  sema_up (&info->loaded);
 
   /* If load failed, quit. */
-  palloc_free_page (file_name);
   if (!success) 
     thread_exit ();
 
@@ -76,18 +184,138 @@ start_process (void *file_name_)
   NOT_REACHED ();
 }
 
+#ifdef VM
+/* Passed from process_fork() to fork_process(). */
+struct fork_info
+  {
+    struct thread *parent;      /* Process being forked. */
+    struct intr_frame if_;      /* Its user context. */
+    struct child *child;        /* Exit status for the parent. */
+    struct semaphore done;      /* Upped when the copy is made. */
+    bool success;               /* Was it? */
+  };
+
+static thread_func fork_process NO_RETURN;
+
+/* Starts a new thread running a copy of the current process,
+   which entered the kernel with the user context in IF_, as from
+   a system call.  The copy resumes from IF_ too, except that it
+   returns 0 in %eax.
+
+   Rather than loading the executable again, the copy starts out
+   sharing all of the current process's pages, and each page is
+   copied only when one of the two processes writes to it.
+   Memory-mapped files stay shared.  The copy has the same open
+   files and runs at the current thread's priority.
+
+   Returns the new process's thread id, or TID_ERROR if the
+   thread cannot be created or memory is short. */
+tid_t
+process_fork (const struct intr_frame *if_) 
+{
+  struct thread *cur = thread_current ();
+  struct fork_info info;
+  tid_t tid;
+
+  info.parent = cur;
+  info.if_ = *if_;
+  info.child = child_create ();
+  if (info.child == NULL)
+    return TID_ERROR;
+  sema_init (&info.done, 0);
+  info.success = false;
+
+  /* Our pages must not change while they are copied, so wait
+     until the child is done with them. */
+  tid = thread_create (cur->name, thread_get_priority (), fork_process,
+                       &info);
+  if (tid != TID_ERROR)
+    sema_down (&info.done);
+
+  if (tid == TID_ERROR)
+    free (info.child);
+  else if (!info.success) 
+    {
+      child_release (info.child);
+      tid = TID_ERROR;
+    }
+  else 
+    {
+      info.child->tid = tid;
+      list_push_back (&cur->children, &info.child->elem);
+    }
+  return tid;
+}
+
+/* A thread function that copies the address space of a process
+   being forked, as described for process_fork(), and starts it
+   running. */
+static void
+fork_process (void *info_) 
+{
+  struct fork_info *info = info_;
+  struct thread *t = thread_current ();
+  struct thread *parent = info->parent;
+  struct intr_frame if_ = info->if_;
+  bool success = false;
+
+  t->pagedir = pagedir_create ();
+  if (t->pagedir == NULL)
+    goto done;
+  process_activate ();
+  if (!page_table_init (&t->pages))
+    goto done;
+  t->exec_file = file_reopen (parent->exec_file);
+  if (t->exec_file == NULL)
+    goto done;
+  file_deny_write (t->exec_file);
+  success = (page_fork (parent) && mmap_fork (parent)
+             && syscall_fork_files (parent));
+
+ done:
+  /* INFO is on the parent's stack, so it goes away as soon as
+     the parent wakes up. */
+  t->child = info->child;
+  info->success = success;
+  sema_up (&info->done);
+  if (!success) 
+    thread_exit ();
+
+  /* Return from the same system call as the parent, as in
+     start_process(). */
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+#endif
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
    child of the calling process, or if process_wait() has already
    been successfully called for the given TID, returns -1
-   immediately, without waiting.
-
-   This function will be implemented in problem 2-2.  For now, it
-   does nothing. */
+   immediately, without waiting. */
 int
-process_wait (tid_t child_tid UNUSED) 
+process_wait (tid_t child_tid) 
 {
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&cur->children); e != list_end (&cur->children);
+       e = list_next (e))
+    {
+      struct child *c = list_entry (e, struct child, elem);
+      if (c->tid == child_tid) 
+        {
+          int status;
+
+          sema_down (&c->dead);
+          status = c->exit_status;
+          list_remove (&c->elem);
+          child_release (c);
+          return status;
+        }
+    }
   return -1;
 }
 
@@ -98,6 +326,17 @@ process_exit (void)
   struct thread *cur = thread_current ();
   uint32_t *pd;
 
+#ifdef VM
+  /* Write back and unmap memory-mapped files, forget where the
+     other pages came from, and close the executable they were
+     read from. */
+  mmap_unmap_all ();
+  page_table_destroy (&cur->pages);
+  file_close (cur->exec_file);
+  cur->exec_file = NULL;
+#endif
+  syscall_close_files ();
+
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = cur->pagedir;
@@ -114,6 +353,21 @@ process_exit (void)
       pagedir_activate (NULL);
       pagedir_destroy (pd);
     }
+
+  /* Now that our files are written back and closed, let our
+     parent know how we exited.  Our children carry on without
+     us. */
+  if (cur->child != NULL) 
+    {
+      printf ("%s: exit(%d)\n", cur->name, cur->exit_status);
+      cur->child->exit_status = cur->exit_status;
+      sema_up (&cur->child->dead);
+      child_release (cur->child);
+      cur->child = NULL;
+    }
+  while (!list_empty (&cur->children))
+    child_release (list_entry (list_pop_front (&cur->children),
+                               struct child, elem));
 }
 
 /* Sets up the CPU for running user code in the current
@@ -195,19 +449,24 @@ struct Elf32_Phdr
 #define PF_W 2          /* Writable. */
 #define PF_R 4          /* Readable. */
 
-static bool setup_stack (void **esp);
+static bool setup_stack (void **esp, const char *cmd_line);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
                           bool writable);
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
+/* Loads an ELF executable into the current thread, from the
+   file named by the first word of CMD_LINE, and passes it the
+   words of CMD_LINE as arguments.
    Stores the executable's entry point into *EIP
    and its initial stack pointer into *ESP.
    Returns true if successful, false otherwise. */
 bool
-load (const char *file_name, void (**eip) (void), void **esp) 
+load (const char *cmd_line, void (**eip) (void), void **esp) 
 {
+  /* One more than the longest file name, so that a longer name
+     is not cut down to one that exists. */
+  char file_name[NAME_MAX + 2];
   struct thread *t = thread_current ();
   struct Elf32_Ehdr ehdr;
   struct file *file = NULL;
@@ -220,8 +479,13 @@ load (const char *file_name, void (**eip) (void), void **esp)
   if (t->pagedir == NULL) 
     goto done;
   process_activate ();
+#ifdef VM
+  if (!page_table_init (&t->pages))
+    goto done;
+#endif
 
   /* Open executable file. */
+  program_name (cmd_line, file_name, sizeof file_name);
   file = filesys_open (file_name);
   if (file == NULL) 
     {
@@ -302,7 +566,7 @@ load (const char *file_name, void (**eip) (void), void **esp)
     }
 
   /* Set up stack. */
-  if (!setup_stack (esp))
+  if (!setup_stack (esp, cmd_line))
     goto done;
 
   /* Start address. */
@@ -312,13 +576,27 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
  done:
   /* We arrive here whether the load is successful or not. */
+#ifdef VM
+  /* The segments are read in on demand, so keep the executable
+     open, and unchanged, for as long as the process runs. */
+  if (success)
+    {
+      file_deny_write (file);
+      t->exec_file = file;
+    }
+  else
+    file_close (file);
+#else
   file_close (file);
+#endif
   return success;
 }
 
 /* load() helpers. */
 
+#ifndef VM
 static bool install_page (void *upage, void *kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -377,6 +655,10 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
    The pages initialized by this function must be writable by the
    user process if WRITABLE is true, read-only otherwise.
 
+   With VM, the pages are only entered into the supplemental page
+   table here, and initialized when the process first touches
+   them.
+
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
 static bool
@@ -396,6 +678,14 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+#ifdef VM
+      /* Record where the page comes from. */
+      if (page_read_bytes > 0
+          ? !page_add_file (upage, file, ofs, page_read_bytes, writable)
+          : !page_add_zero (upage, writable))
+        return false;
+      ofs += page_read_bytes;
+#else
       /* Get a page of memory. */
       uint8_t *kpage = palloc_get_page (PAL_USER);
       if (kpage == NULL)
@@ -415,6 +705,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
           palloc_free_page (kpage);
           return false; 
         }
+#endif
 
       /* Advance. */
       read_bytes -= page_read_bytes;
@@ -424,26 +715,73 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   return true;
 }
 
+/* Pushes the words of CMD_LINE, separated by spaces, onto the
+   empty user stack as the arguments to the program's main(),
+   and stores the resulting stack pointer into *ESP.  Returns
+   false if they do not fit in the stack's one page. */
+static bool
+push_args (void **esp, const char *cmd_line) 
+{
+  size_t len = strlen (cmd_line) + 1;
+  size_t argv_max = len / 2 + 1;        /* Bound on the word count. */
+  char *args, *token, *save_ptr;
+  char **argv;
+  uint32_t *sp;
+  int argc = 0;
+
+  /* The words, argv[] with its null terminator, argv, argc, a
+     return address, and up to 3 bytes of alignment. */
+  if (len + (argv_max + 1) * sizeof *argv + 3 * sizeof *sp + 3 > PGSIZE)
+    return false;
+
+  /* Copy the words to the top of the stack and split them up in
+     place, with argv[] below them. */
+  args = (char *) PHYS_BASE - len;
+  strlcpy (args, cmd_line, len);
+  argv = ((char **) ROUND_DOWN ((uintptr_t) args, sizeof *argv)
+          - (argv_max + 1));
+  for (token = strtok_r (args, " ", &save_ptr); token != NULL;
+       token = strtok_r (NULL, " ", &save_ptr))
+    argv[argc++] = token;
+  argv[argc] = NULL;
+
+  /* main()'s arguments and a fake return address. */
+  sp = (uint32_t *) argv;
+  *--sp = (uint32_t) argv;
+  *--sp = argc;
+  *--sp = 0;
+  *esp = sp;
+  return true;
+}
+
 /* Create a minimal stack by mapping a zeroed page at the top of
-   user virtual memory. */
+   user virtual memory, and push the arguments in CMD_LINE onto
+   it. */
 static bool
-setup_stack (void **esp) 
+setup_stack (void **esp, const char *cmd_line) 
 {
+  uint8_t *upage = ((uint8_t *) PHYS_BASE) - PGSIZE;
+#ifdef VM
+  /* Go through the supplemental page table, so that the stack
+     can be evicted like any other page. */
+  if (!page_add_zero (upage, true) || !page_load (upage))
+    return false;
+#else
   uint8_t *kpage;
-  bool success = false;
 
   kpage = palloc_get_page (PAL_USER | PAL_ZERO);
-  if (kpage != NULL) 
+  if (kpage == NULL)
+    return false;
+  if (!install_page (upage, kpage, true)) 
     {
-      success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
-      if (success)
-        *esp = PHYS_BASE;
-      else
-        palloc_free_page (kpage);
+      palloc_free_page (kpage);
+      return false;
     }
-  return success;
+#endif
+  return push_args (esp, cmd_line);
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -463,3 +801,4 @@ install_page (void *upage, void *kpage, bool writable)
   return (pagedir_get_page (t->pagedir, upage) == NULL
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
+#endif
@@ -1,20 +1,416 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
+#include "devices/input.h"
+#include "devices/shutdown.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#endif
+
+/* An open file, in its process's list of files. */
+struct file_desc
+  {
+    struct list_elem elem;      /* Element in thread's `files'. */
+    int handle;                 /* File descriptor. */
+    struct file *file;          /* Open file. */
+  };
+
+/* Serializes calls into the file system on behalf of user
+   processes. */
+struct lock filesys_lock;
+
+/* Number of arguments that each system call takes, or -1 for
+   system calls that are not implemented. */
+static const int arg_cnts[] =
+  {
+    [SYS_HALT] = 0, [SYS_EXIT] = 1, [SYS_EXEC] = 1, [SYS_WAIT] = 1,
+    [SYS_CREATE] = 2, [SYS_REMOVE] = 1, [SYS_OPEN] = 1,
+    [SYS_FILESIZE] = 1, [SYS_READ] = 3, [SYS_WRITE] = 3,
+    [SYS_SEEK] = 2, [SYS_TELL] = 1, [SYS_CLOSE] = 1,
+#ifdef VM
+    [SYS_MMAP] = 2, [SYS_MUNMAP] = 1,
+#else
+    [SYS_MMAP] = -1, [SYS_MUNMAP] = -1,
+#endif
+    [SYS_CHDIR] = -1, [SYS_MKDIR] = -1, [SYS_READDIR] = -1,
+    [SYS_ISDIR] = -1, [SYS_INUMBER] = -1,
+#ifdef VM
+    [SYS_FORK] = 0,
+#else
+    [SYS_FORK] = -1,
+#endif
+  };
 
 static void syscall_handler (struct intr_frame *);
+static void sys_exit (int status) NO_RETURN;
 
 void
-syscall_init (void) 
+syscall_init (void)
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
+  lock_init (&filesys_lock);
+  lock_set_name (&filesys_lock, "filesys");
+}
+
+/* Returns true if the current process may read the user page
+   that contains UADDR, and write it too if WRITE is true.
+
+   With VM, a page in the supplemental page table need not be
+   present: the kernel faults it in when it touches the page, as
+   the process would.  Neither need a page of stack that the
+   process has not grown into yet. */
+static bool
+user_page_ok (const void *uaddr, bool write)
+{
+  struct thread *cur = thread_current ();
+  void *upage = pg_round_down (uaddr);
+  uint32_t *pd = cur->pagedir;
+#ifdef VM
+  struct page *p = page_lookup (&cur->pages, upage);
+
+  if (p != NULL)
+    return p->writable || !write;
+  if (pagedir_get_page (pd, upage) == NULL)
+    return page_grow_stack (uaddr, cur->syscall_esp);
+#endif
+  return (write
+          ? pagedir_is_writable (pd, upage)
+          : pagedir_get_page (pd, upage) != NULL);
+}
+
+/* Terminates the current process unless it may read the SIZE
+   bytes starting at user address UADDR, and write them too if
+   WRITE is true. */
+static void
+check_user (const void *uaddr, size_t size, bool write)
+{
+  const uint8_t *start = uaddr;
+  const uint8_t *end = start + size;
+  const uint8_t *p;
+
+  if (size == 0)
+    return;
+  if (end < start || !is_user_vaddr (end - 1))
+    sys_exit (-1);
+  for (p = start; p < end; p = pg_round_down (p) + PGSIZE)
+    if (!user_page_ok (p, write))
+      sys_exit (-1);
+}
+
+/* Checks that the null-terminated string USTR lies entirely in
+   readable user memory, terminating the process if it does not,
+   and returns USTR. */
+static const char *
+check_string (const char *ustr)
+{
+  const char *p;
+
+  for (p = ustr; ; p++)
+    {
+      if (p == ustr || pg_ofs (p) == 0)
+        check_user (p, 1, false);
+      if (*p == '\0')
+        return ustr;
+    }
+}
+
+/* Copies SIZE bytes from user address USRC to KDST, terminating
+   the process if any of them are not readable. */
+static void
+copy_in (void *kdst, const void *usrc, size_t size)
+{
+  check_user (usrc, size, false);
+  memcpy (kdst, usrc, size);
+}
+
+/* Returns the current process's open file with the given
+   HANDLE, or a null pointer if there is none. */
+static struct file_desc *
+find_fd (int handle)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&cur->files); e != list_end (&cur->files);
+       e = list_next (e))
+    {
+      struct file_desc *fd = list_entry (e, struct file_desc, elem);
+      if (fd->handle == handle)
+        return fd;
+    }
+  return NULL;
+}
+
+/* Returns the current process's open file with the given
+   HANDLE, terminating the process if there is none. */
+static struct file_desc *
+lookup_fd (int handle)
+{
+  struct file_desc *fd = find_fd (handle);
+  if (fd == NULL)
+    sys_exit (-1);
+  return fd;
 }
 
 static void
-syscall_handler (struct intr_frame *f UNUSED) 
+syscall_handler (struct intr_frame *f)
 {
-  printf ("system call!\n");
+  int nr;
+  uint32_t args[3];
+
+  thread_current ()->syscall_esp = f->esp;
+  copy_in (&nr, f->esp, sizeof nr);
+  if (nr < 0 || nr >= (int) (sizeof arg_cnts / sizeof *arg_cnts)
+      || arg_cnts[nr] < 0)
+    sys_exit (-1);
+  copy_in (args, (uint32_t *) f->esp + 1, arg_cnts[nr] * sizeof *args);
+
+  switch (nr)
+    {
+    case SYS_HALT:
+      shutdown_power_off ();
+
+    case SYS_EXIT:
+      sys_exit (args[0]);
+
+    case SYS_EXEC:
+      f->eax = process_execute (check_string ((const char *) args[0]));
+      break;
+
+    case SYS_WAIT:
+      f->eax = process_wait (args[0]);
+      break;
+
+    case SYS_CREATE:
+      check_string ((const char *) args[0]);
+      lock_acquire (&filesys_lock);
+      f->eax = filesys_create ((const char *) args[0], args[1]);
+      lock_release (&filesys_lock);
+      break;
+
+    case SYS_REMOVE:
+      check_string ((const char *) args[0]);
+      lock_acquire (&filesys_lock);
+      f->eax = filesys_remove ((const char *) args[0]);
+      lock_release (&filesys_lock);
+      break;
+
+    case SYS_OPEN:
+      {
+        struct thread *cur = thread_current ();
+        struct file_desc *fd;
+
+        check_string ((const char *) args[0]);
+        f->eax = -1;
+        fd = malloc (sizeof *fd);
+        if (fd == NULL)
+          break;
+        lock_acquire (&filesys_lock);
+        fd->file = filesys_open ((const char *) args[0]);
+        lock_release (&filesys_lock);
+        if (fd->file == NULL)
+          {
+            free (fd);
+            break;
+          }
+        fd->handle = cur->next_fd++;
+        list_push_back (&cur->files, &fd->elem);
+        f->eax = fd->handle;
+      }
+      break;
+
+    case SYS_FILESIZE:
+      {
+        struct file_desc *fd = lookup_fd (args[0]);
+
+        lock_acquire (&filesys_lock);
+        f->eax = file_length (fd->file);
+        lock_release (&filesys_lock);
+      }
+      break;
+
+    case SYS_READ:
+      {
+        uint8_t *buffer = (uint8_t *) args[1];
+        unsigned size = args[2];
+
+        check_user (buffer, size, true);
+        if (args[0] == STDIN_FILENO)
+          {
+            unsigned i;
+
+            for (i = 0; i < size; i++)
+              buffer[i] = input_getc ();
+            f->eax = size;
+          }
+        else
+          {
+            struct file_desc *fd = lookup_fd (args[0]);
+
+            lock_acquire (&filesys_lock);
+            f->eax = file_read (fd->file, buffer, size);
+            lock_release (&filesys_lock);
+          }
+      }
+      break;
+
+    case SYS_WRITE:
+      {
+        const void *buffer = (const void *) args[1];
+        unsigned size = args[2];
+
+        check_user (buffer, size, false);
+        if (args[0] == STDOUT_FILENO)
+          {
+            putbuf (buffer, size);
+            f->eax = size;
+          }
+        else
+          {
+            struct file_desc *fd = lookup_fd (args[0]);
+
+            lock_acquire (&filesys_lock);
+            f->eax = file_write (fd->file, buffer, size);
+            lock_release (&filesys_lock);
+          }
+      }
+      break;
+
+    case SYS_SEEK:
+      {
+        struct file_desc *fd = lookup_fd (args[0]);
+
+        lock_acquire (&filesys_lock);
+        file_seek (fd->file, args[1]);
+        lock_release (&filesys_lock);
+      }
+      break;
+
+    case SYS_TELL:
+      {
+        struct file_desc *fd = lookup_fd (args[0]);
+
+        lock_acquire (&filesys_lock);
+        f->eax = file_tell (fd->file);
+        lock_release (&filesys_lock);
+      }
+      break;
+
+    case SYS_CLOSE:
+      {
+        struct file_desc *fd = lookup_fd (args[0]);
+
+        lock_acquire (&filesys_lock);
+        file_close (fd->file);
+        lock_release (&filesys_lock);
+        list_remove (&fd->elem);
+        free (fd);
+      }
+      break;
+
+#ifdef VM
+    case SYS_MMAP:
+      {
+        struct file_desc *fd = find_fd (args[0]);
+
+        f->eax = MAP_FAILED;
+        if (fd == NULL)
+          break;
+        lock_acquire (&filesys_lock);
+        f->eax = mmap_map (fd->file, (void *) args[1]);
+        lock_release (&filesys_lock);
+      }
+      break;
+
+    case SYS_MUNMAP:
+      lock_acquire (&filesys_lock);
+      mmap_unmap (args[0]);
+      lock_release (&filesys_lock);
+      break;
+
+    case SYS_FORK:
+      f->eax = process_fork (f);
+      break;
+#endif
+
+    default:
+      NOT_REACHED ();
+    }
+}
+
+/* Terminates the current process with exit status STATUS. */
+static void
+sys_exit (int status)
+{
+  thread_current ()->exit_status = status;
   thread_exit ();
 }
+
+/* Closes all of the current process's open files, as it
+   exits. */
+void
+syscall_close_files (void)
+{
+  struct thread *cur = thread_current ();
+
+  if (list_empty (&cur->files))
+    return;
+  lock_acquire (&filesys_lock);
+  while (!list_empty (&cur->files))
+    {
+      struct file_desc *fd = list_entry (list_pop_front (&cur->files),
+                                         struct file_desc, elem);
+      file_close (fd->file);
+      free (fd);
+    }
+  lock_release (&filesys_lock);
+}
+
+/* Gives the current process the same open files, with the same
+   handles and positions, as PARENT, the process it is being
+   forked from.  Returns true if successful, false if memory is
+   short. */
+bool
+syscall_fork_files (struct thread *parent)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+  bool success = true;
+
+  lock_acquire (&filesys_lock);
+  for (e = list_begin (&parent->files); e != list_end (&parent->files);
+       e = list_next (e))
+    {
+      struct file_desc *pfd = list_entry (e, struct file_desc, elem);
+      struct file_desc *fd = malloc (sizeof *fd);
+
+      if (fd == NULL)
+        {
+          success = false;
+          break;
+        }
+      fd->file = file_reopen (pfd->file);
+      if (fd->file == NULL)
+        {
+          free (fd);
+          success = false;
+          break;
+        }
+      file_seek (fd->file, file_tell (pfd->file));
+      fd->handle = pfd->handle;
+      list_push_back (&cur->files, &fd->elem);
+    }
+  lock_release (&filesys_lock);
+  cur->next_fd = parent->next_fd;
+  return success;
+}
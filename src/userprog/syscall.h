@@ -1,6 +1,16 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <stdbool.h>
+#include "threads/synch.h"
+
+struct thread;
+
+/* Held around calls into the file system for user processes. */
+extern struct lock filesys_lock;
+
 void syscall_init (void);
+void syscall_close_files (void);
+bool syscall_fork_files (struct thread *parent);
 
 #endif /* userprog/syscall.h */
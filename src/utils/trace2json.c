@@ -0,0 +1,247 @@
+/* Converts a kernel event trace, written to the scratch device
+   by the "trace-dump" kernel action, into Chrome's trace event
+   JSON format, for viewing in chrome://tracing or Perfetto.
+
+   usage: trace2json DISK [OUTPUT]
+
+   DISK may be the scratch partition itself or any disk image
+   that contains it, such as one made with pintos-mkdisk; the
+   dump is located by the magic number in its first sector.
+   The JSON goes to OUTPUT, or to stdout if OUTPUT is omitted.
+
+   Each CPU gets a track showing which thread it ran, from the
+   context switch events.  Each thread gets a track of its own
+   showing the interrupts it took and its other events.  The
+   record layout must match threads/trace.h. */
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SECTOR_SIZE 512
+#define TRACE_MAGIC "PINTRACE"
+#define TRACE_VERSION 1
+#define RECORD_SIZE 24
+#define CPU_MAX 8
+
+/* Events, as in enum trace_event. */
+enum
+  {
+    TRACE_SCHEDULE,
+    TRACE_THREAD_BLOCK,
+    TRACE_THREAD_UNBLOCK,
+    TRACE_SEMA_DOWN,
+    TRACE_SEMA_UP,
+    TRACE_INTR_ENTER,
+    TRACE_INTR_EXIT,
+    TRACE_BLOCK_READ,
+    TRACE_BLOCK_WRITE,
+    TRACE_PAGE_FAULT,
+    TRACE_EVENT_CNT
+  };
+
+/* Names of instant events and of their two arguments. */
+static const char *event_names[TRACE_EVENT_CNT][3] =
+  {
+    [TRACE_THREAD_BLOCK] = {"block", "caller", NULL},
+    [TRACE_THREAD_UNBLOCK] = {"unblock", "tid", "priority"},
+    [TRACE_SEMA_DOWN] = {"sema_down", "sema", "value"},
+    [TRACE_SEMA_UP] = {"sema_up", "sema", "value"},
+    [TRACE_BLOCK_READ] = {"block_read", "type", "sector"},
+    [TRACE_BLOCK_WRITE] = {"block_write", "type", "sector"},
+    [TRACE_PAGE_FAULT] = {"page_fault", "addr", "error"},
+  };
+
+/* A decoded trace record. */
+struct record
+  {
+    uint64_t time;
+    unsigned event;
+    unsigned cpu;
+    int32_t tid;
+    uint32_t arg0, arg1;
+    size_t seq;                 /* Position in the dump. */
+  };
+
+static void
+fail (const char *msg, ...)
+{
+  va_list args;
+
+  va_start (args, msg);
+  fprintf (stderr, "trace2json: ");
+  vfprintf (stderr, msg, args);
+  va_end (args);
+
+  if (errno != 0)
+    fprintf (stderr, ": %s", strerror (errno));
+  putc ('\n', stderr);
+  exit (EXIT_FAILURE);
+}
+
+/* Returns the little-endian integer of SIZE bytes at P. */
+static uint64_t
+get_le (const unsigned char *p, int size)
+{
+  uint64_t x = 0;
+
+  while (size-- > 0)
+    x = (x << 8) | p[size];
+  return x;
+}
+
+/* Orders records by time, then by position in the dump. */
+static int
+record_compare (const void *a_, const void *b_)
+{
+  const struct record *a = a_;
+  const struct record *b = b_;
+
+  if (a->time != b->time)
+    return a->time < b->time ? -1 : 1;
+  return a->seq < b->seq ? -1 : a->seq > b->seq;
+}
+
+/* Prints the fields common to all events in R. */
+static void
+print_event (FILE *out, const struct record *r, const char *phase,
+             int pid, int tid)
+{
+  fprintf (out, ",\n{\"ph\":\"%s\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f",
+           phase, pid, tid, r->time / 1000.0);
+}
+
+int
+main (int argc, char *argv[])
+{
+  unsigned char sector[SECTOR_SIZE];
+  unsigned char raw[RECORD_SIZE];
+  struct record *records;
+  uint32_t record_cnt, lost_cnt;
+  int32_t running[CPU_MAX];
+  FILE *in, *out;
+  size_t i;
+
+  if (argc < 2 || argc > 3)
+    {
+      fprintf (stderr, "usage: trace2json DISK [OUTPUT]\n");
+      return EXIT_FAILURE;
+    }
+
+  in = fopen (argv[1], "rb");
+  if (in == NULL)
+    fail ("%s: open", argv[1]);
+  out = argc > 2 ? fopen (argv[2], "w") : stdout;
+  if (out == NULL)
+    fail ("%s: create", argv[2]);
+
+  /* Find and check the header. */
+  for (;;)
+    {
+      errno = 0;
+      if (fread (sector, SECTOR_SIZE, 1, in) != 1)
+        fail ("%s: no trace dump found", argv[1]);
+      if (!memcmp (sector, TRACE_MAGIC, 8))
+        break;
+    }
+  errno = 0;
+  if (get_le (sector + 8, 4) != TRACE_VERSION)
+    fail ("%s: unsupported trace version %u", argv[1],
+          (unsigned) get_le (sector + 8, 4));
+  if (get_le (sector + 12, 4) != RECORD_SIZE)
+    fail ("%s: unexpected record size %u", argv[1],
+          (unsigned) get_le (sector + 12, 4));
+  record_cnt = get_le (sector + 16, 4);
+  lost_cnt = get_le (sector + 20, 4);
+
+  /* Read and sort the records. */
+  records = malloc ((record_cnt + 1) * sizeof *records);
+  if (records == NULL)
+    fail ("out of memory");
+  for (i = 0; i < record_cnt; i++)
+    {
+      struct record *r = &records[i];
+
+      errno = 0;
+      if (fread (raw, RECORD_SIZE, 1, in) != 1)
+        fail ("%s: truncated after %zu of %u records", argv[1],
+              i, (unsigned) record_cnt);
+      r->time = get_le (raw, 8);
+      r->event = get_le (raw + 8, 2);
+      r->cpu = get_le (raw + 10, 2);
+      r->tid = (int32_t) get_le (raw + 12, 4);
+      r->arg0 = get_le (raw + 16, 4);
+      r->arg1 = get_le (raw + 20, 4);
+      r->seq = i;
+      if (r->cpu >= CPU_MAX)
+        fail ("%s: record %zu: bad CPU %u", argv[1], i, r->cpu);
+    }
+  fclose (in);
+  qsort (records, record_cnt, sizeof *records, record_compare);
+
+  /* Name the tracks. */
+  fprintf (out, "{\"otherData\":{\"lost\":%u},\n\"traceEvents\":[\n"
+           "{\"ph\":\"M\",\"pid\":0,\"name\":\"process_name\","
+           "\"args\":{\"name\":\"CPUs\"}},\n"
+           "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\","
+           "\"args\":{\"name\":\"Threads\"}}", (unsigned) lost_cnt);
+
+  for (i = 0; i < CPU_MAX; i++)
+    running[i] = -1;
+  for (i = 0; i < record_cnt; i++)
+    {
+      const struct record *r = &records[i];
+
+      switch (r->event)
+        {
+        case TRACE_SCHEDULE:
+          if (running[r->cpu] != -1)
+            {
+              print_event (out, r, "E", 0, r->cpu);
+              fprintf (out, "}");
+            }
+          print_event (out, r, "B", 0, r->cpu);
+          fprintf (out, ",\"name\":\"thread %d\"}", (int) r->arg1);
+          running[r->cpu] = r->arg1;
+          break;
+
+        case TRACE_INTR_ENTER:
+          print_event (out, r, "B", 1, r->tid);
+          fprintf (out, ",\"name\":\"intr %#04x\",\"args\":{\"eip\":\"%#x\"}}",
+                   (unsigned) r->arg0, (unsigned) r->arg1);
+          break;
+
+        case TRACE_INTR_EXIT:
+          print_event (out, r, "E", 1, r->tid);
+          fprintf (out, "}");
+          break;
+
+        default:
+          if (r->event >= TRACE_EVENT_CNT || event_names[r->event][0] == NULL)
+            {
+              fprintf (stderr, "trace2json: skipping unknown event %u\n",
+                       r->event);
+              break;
+            }
+          print_event (out, r, "i", 1, r->tid);
+          fprintf (out, ",\"s\":\"t\",\"name\":\"%s\",\"args\":{",
+                   event_names[r->event][0]);
+          fprintf (out, "\"%s\":\"%#x\"", event_names[r->event][1],
+                   (unsigned) r->arg0);
+          if (event_names[r->event][2] != NULL)
+            fprintf (out, ",\"%s\":%u", event_names[r->event][2],
+                     (unsigned) r->arg1);
+          fprintf (out, "}}");
+          break;
+        }
+    }
+  fprintf (out, "\n]}\n");
+  free (records);
+
+  if (out != stdout && fclose (out) != 0)
+    fail ("%s: close", argv[2]);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,710 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+
+/* All frames, in clock order, with the clock hand, and the page
+   cache, which holds the frames of memory-mapped files by inode
+   and offset.  frame_lock protects these, every struct frame,
+   and the `frame', `frame_elem', `type' and `swap_slot' members
+   of every struct page that has a frame.  frame_cond is
+   signaled whenever a frame is unpinned. */
+static struct list frames;
+static struct list_elem *hand;
+static struct hash page_cache;
+static struct lock frame_lock;
+static struct condition frame_cond;
+
+/* Cache of struct frame. */
+static struct kmem_cache *frame_cache;
+
+/* Most pages evicted at once. */
+#define EVICT_BATCH SWAP_CLUSTER
+
+/* Statistics. */
+static size_t frame_cnt;                /* Frames in the table. */
+static long long evict_cnt;             /* Pages evicted. */
+static long long swap_out_cnt;          /* ...of which, written to swap. */
+static long long writeback_cnt;         /* Mapped pages written back. */
+static long long shared_cnt;            /* Faults served from the cache. */
+static long long fork_share_cnt;        /* Frames shared by fork. */
+static long long cow_copy_cnt;          /* ...and copied on write. */
+
+static struct frame *evict (void);
+static void free_frame (struct frame *);
+static hash_hash_func cache_hash;
+static hash_less_func cache_less;
+
+/* Initializes the frame table. */
+void
+frame_init (void) 
+{
+  list_init (&frames);
+  hand = list_end (&frames);
+  lock_init (&frame_lock);
+  lock_set_name (&frame_lock, "frame");
+  cond_init (&frame_cond);
+  if (!hash_init (&page_cache, cache_hash, cache_less, NULL))
+    PANIC ("frame_init: out of memory");
+  frame_cache = kmem_cache_create ("frame", sizeof (struct frame), 0, NULL);
+  if (frame_cache == NULL)
+    PANIC ("frame_init: out of memory");
+}
+
+/* Waits until P is not being evicted.  frame_lock must be
+   held. */
+static void
+wait_for_eviction (struct page *p) 
+{
+  while (p->frame != NULL && p->frame->pinned)
+    cond_wait (&frame_cond, &frame_lock);
+}
+
+/* Makes F hold page P. */
+static void
+attach (struct frame *f, struct page *p) 
+{
+  list_push_back (&f->pages, &p->frame_elem);
+  p->frame = f;
+}
+
+/* Returns true if F holds more than one page. */
+static bool
+is_shared (struct frame *f) 
+{
+  return list_begin (&f->pages) != list_rbegin (&f->pages);
+}
+
+/* Returns true if page P, which F holds, may be written through
+   its mapping: if P is writable, and F is not shared copy-on-
+   write with another process. */
+static bool
+may_write (struct frame *f, struct page *p) 
+{
+  return p->writable && (f->inode != NULL || !is_shared (f));
+}
+
+/* Makes F hold no pages, and takes it out of the page cache. */
+static void
+detach_all (struct frame *f) 
+{
+  while (!list_empty (&f->pages)) 
+    {
+      struct page *p = list_entry (list_pop_front (&f->pages),
+                                   struct page, frame_elem);
+      p->frame = NULL;
+    }
+  if (f->inode != NULL) 
+    {
+      hash_delete (&page_cache, &f->cache_elem);
+      f->inode = NULL;
+    }
+}
+
+/* Obtains a frame for page P, as described for frame_alloc(),
+   evicting pages only if MAY_EVICT is true. */
+static struct frame *
+get_frame (struct page *p, enum palloc_flags flags, bool may_evict) 
+{
+  struct frame *f = NULL;
+  void *kpage;
+
+  kpage = palloc_get_page (PAL_USER | flags);
+  if (kpage != NULL) 
+    {
+      f = kmem_cache_alloc (frame_cache);
+      if (f == NULL)
+        palloc_free_page (kpage);
+      else
+        {
+          f->kpage = kpage;
+          list_init (&f->pages);
+          f->inode = NULL;
+          list_push_back (&frames, &f->elem);
+          frame_cnt++;
+        }
+    }
+  else if (may_evict)
+    {
+      f = evict ();
+      if (f != NULL && (flags & PAL_ZERO))
+        memset (f->kpage, 0, PGSIZE);
+    }
+
+  if (f != NULL) 
+    {
+      f->pinned = true;
+      attach (f, p);
+    }
+  return f;
+}
+
+/* Obtains a frame for page P, which belongs to the current
+   process and must not have one.  If FLAGS includes PAL_ZERO,
+   the frame is zeroed.  Returns the frame, pinned, for the
+   caller to fill in and then unpin with frame_unpin().  Returns
+   a null pointer if there is no free frame and none can be
+   evicted. */
+struct frame *
+frame_alloc (struct page *p, enum palloc_flags flags) 
+{
+  struct frame *f;
+
+  lock_acquire (&frame_lock);
+  wait_for_eviction (p);
+  ASSERT (p->frame == NULL);
+  f = get_frame (p, flags, true);
+  lock_release (&frame_lock);
+
+  return f;
+}
+
+/* Like frame_alloc(), but for reading P ahead of need: returns
+   a null pointer, rather than waiting or evicting anything, if
+   P is in memory or on its way out of it or if there is no free
+   frame. */
+struct frame *
+frame_try_alloc (struct page *p) 
+{
+  struct frame *f = NULL;
+
+  lock_acquire (&frame_lock);
+  if (p->frame == NULL)
+    f = get_frame (p, 0, false);
+  lock_release (&frame_lock);
+
+  return f;
+}
+
+/* Returns the frame in the page cache for offset OFS in INODE,
+   or a null pointer if there is none. */
+static struct frame *
+cache_lookup (struct inode *inode, off_t ofs) 
+{
+  struct frame key;
+  struct hash_elem *e;
+
+  key.inode = inode;
+  key.ofs = ofs;
+  e = hash_find (&page_cache, &key.cache_elem);
+  return e != NULL ? hash_entry (e, struct frame, cache_elem) : NULL;
+}
+
+/* Obtains a frame for P, a PAGE_MMAP page of the current
+   process that does not have one.
+
+   If the page of P's file at P's offset is already in the page
+   cache, because another process has it mapped, maps P to that
+   frame, sets *SHARED to true, and returns the frame, unpinned.
+   Otherwise, obtains a frame as frame_alloc() does, enters it
+   in the page cache, sets *SHARED to false, and returns it,
+   pinned, to be filled in from the file.  Returns a null
+   pointer if no frame is available. */
+struct frame *
+frame_alloc_shared (struct page *p, bool *shared) 
+{
+  struct inode *inode = file_get_inode (p->file);
+  struct frame *f;
+
+  ASSERT (p->type == PAGE_MMAP);
+
+  lock_acquire (&frame_lock);
+  wait_for_eviction (p);
+  ASSERT (p->frame == NULL);
+  for (;;) 
+    {
+      f = cache_lookup (inode, p->ofs);
+      if (f != NULL) 
+        {
+          /* Wait until it is read in, or it is gone. */
+          if (f->pinned) 
+            {
+              cond_wait (&frame_cond, &frame_lock);
+              continue;
+            }
+          *shared = true;
+          if (pagedir_set_page (p->owner->pagedir, p->upage, f->kpage,
+                                p->writable))
+            {
+              attach (f, p);
+              shared_cnt++;
+            }
+          else
+            f = NULL;
+          break;
+        }
+
+      *shared = false;
+      f = get_frame (p, 0, true);
+      if (f == NULL)
+        break;
+      if (cache_lookup (inode, p->ofs) != NULL) 
+        {
+          /* Someone else read it in while evict() had dropped
+             the lock.  Use theirs. */
+          free_frame (f);
+          cond_broadcast (&frame_cond, &frame_lock);
+          continue;
+        }
+      f->inode = inode;
+      f->ofs = p->ofs;
+      hash_insert (&page_cache, &f->cache_elem);
+      break;
+    }
+  lock_release (&frame_lock);
+
+  return f;
+}
+
+/* Makes CHILD, a page of the current process, a copy of PARENT,
+   the page at the same address in the process that the current
+   one was forked from, which must not be a PAGE_MMAP page.
+
+   If PARENT is in a frame, CHILD shares it, and the frame is
+   mapped read-only in both processes until one of them writes
+   to it and frame_unshare() gives it a copy of its own.  If
+   PARENT is in swap, CHILD shares its swap slot.  Otherwise
+   CHILD comes from the same place PARENT does.  Returns true if
+   successful, false if memory is short. */
+bool
+frame_fork (struct page *parent, struct page *child) 
+{
+  struct frame *f;
+  bool success = true;
+
+  ASSERT (parent->type != PAGE_MMAP);
+  ASSERT (child->frame == NULL);
+
+  lock_acquire (&frame_lock);
+  wait_for_eviction (parent);
+  f = parent->frame;
+  if (f != NULL) 
+    {
+      uint32_t *parent_pd = parent->owner->pagedir;
+
+      /* Once shared, the frame cannot be dirtied through either
+         mapping, so record now that it has to go to swap. */
+      if (pagedir_is_dirty (parent_pd, parent->upage))
+        parent->type = PAGE_SWAP;
+      child->type = parent->type;
+      if (pagedir_set_page (child->owner->pagedir, child->upage, f->kpage,
+                            false))
+        {
+          pagedir_set_writable (parent_pd, parent->upage, false);
+          attach (f, child);
+          fork_share_cnt++;
+        }
+      else
+        success = false;
+    }
+  else 
+    {
+      child->type = parent->type;
+      if (parent->swap_slot != SWAP_ERROR) 
+        {
+          swap_share (parent->swap_slot, 1);
+          child->swap_slot = parent->swap_slot;
+        }
+    }
+  lock_release (&frame_lock);
+
+  return success;
+}
+
+/* Makes P, a writable page of the current process whose mapping
+   is read-only because its frame was shared by frame_fork(),
+   writable again.  If the frame is still shared, P first gets a
+   copy of its own.  Returns true if successful, false if no
+   frame is available for the copy. */
+bool
+frame_unshare (struct page *p) 
+{
+  uint32_t *pd = p->owner->pagedir;
+  struct frame *f;
+  bool success = true;
+
+  ASSERT (p->writable);
+  ASSERT (p->type != PAGE_MMAP);
+
+  lock_acquire (&frame_lock);
+  wait_for_eviction (p);
+  f = p->frame;
+  if (f == NULL) 
+    {
+      /* Evicted meanwhile.  The write will fault again, and
+         page_load() will bring in a copy of P's own. */
+    }
+  else if (!is_shared (f))
+    pagedir_set_writable (pd, p->upage, true);
+  else
+    {
+      struct frame *copy;
+
+      /* Keep F in place while evict() may have the lock
+         released. */
+      f->pinned = true;
+      list_remove (&p->frame_elem);
+      p->frame = NULL;
+      copy = get_frame (p, 0, true);
+      if (copy != NULL) 
+        {
+          memcpy (copy->kpage, f->kpage, PGSIZE);
+          pagedir_clear_page (pd, p->upage);
+
+          /* Cannot fail: the page table entry is still there. */
+          pagedir_set_page (pd, p->upage, copy->kpage, true);
+          copy->pinned = false;
+          cow_copy_cnt++;
+        }
+      else
+        {
+          attach (f, p);
+          success = false;
+        }
+      f->pinned = false;
+      cond_broadcast (&frame_cond, &frame_lock);
+    }
+  lock_release (&frame_lock);
+
+  return success;
+}
+
+/* Unpins F, whose contents are now in place and mapped. */
+void
+frame_unpin (struct frame *f) 
+{
+  lock_acquire (&frame_lock);
+  ASSERT (f->pinned);
+  f->pinned = false;
+  cond_broadcast (&frame_cond, &frame_lock);
+  lock_release (&frame_lock);
+}
+
+/* Removes F from the frame table and frees it.  F must be
+   pinned by the caller, or hold no mapped pages and not be being
+   evicted. */
+static void
+free_frame (struct frame *f) 
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  if (hand == &f->elem)
+    hand = list_next (hand);
+  list_remove (&f->elem);
+  frame_cnt--;
+  detach_all (f);
+  palloc_free_page (f->kpage);
+  kmem_cache_free (frame_cache, f);
+}
+
+/* Frees F, a frame obtained from frame_alloc() that has not yet
+   been unpinned, because its page could not be brought in. */
+void
+frame_free (struct frame *f) 
+{
+  lock_acquire (&frame_lock);
+  ASSERT (f->pinned);
+  free_frame (f);
+  cond_broadcast (&frame_cond, &frame_lock);
+  lock_release (&frame_lock);
+}
+
+/* Takes P, a page of the current process, out of its frame, if
+   it has one, first waiting for any eviction of P to finish.
+   P's mapping is removed from the page directory, and if P is a
+   PAGE_MMAP page that P's owner modified, it is written back to
+   its file.  The frame is freed if it holds no other page. */
+void
+frame_drop (struct page *p) 
+{
+  struct frame *f;
+
+  lock_acquire (&frame_lock);
+  wait_for_eviction (p);
+  f = p->frame;
+  if (f != NULL) 
+    {
+      uint32_t *pd = p->owner->pagedir;
+
+      pagedir_clear_page (pd, p->upage);
+      list_remove (&p->frame_elem);
+      p->frame = NULL;
+      if (p->type == PAGE_MMAP && pagedir_is_dirty (pd, p->upage)) 
+        {
+          f->pinned = true;
+          lock_release (&frame_lock);
+          file_write_at (p->file, f->kpage, p->read_bytes, p->ofs);
+          lock_acquire (&frame_lock);
+          f->pinned = false;
+          cond_broadcast (&frame_cond, &frame_lock);
+          writeback_cnt++;
+        }
+      if (list_empty (&f->pages))
+        free_frame (f);
+    }
+  lock_release (&frame_lock);
+}
+
+/* Advances the clock hand and returns the frame it passed. */
+static struct frame *
+clock_next (void) 
+{
+  struct frame *f;
+
+  if (hand == list_end (&frames))
+    hand = list_begin (&frames);
+  f = list_entry (hand, struct frame, elem);
+  hand = list_next (hand);
+  return f;
+}
+
+/* Returns true if any page in F has been accessed since this
+   was last called for F, and clears their accessed bits. */
+static bool
+frame_accessed (struct frame *f) 
+{
+  struct list_elem *e;
+  bool accessed = false;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      uint32_t *pd = p->owner->pagedir;
+
+      if (pagedir_is_accessed (pd, p->upage)) 
+        {
+          pagedir_set_accessed (pd, p->upage, false);
+          accessed = true;
+        }
+    }
+  return accessed;
+}
+
+/* Returns a page in F that has been modified through its
+   mapping, or a null pointer if there is none. */
+static struct page *
+frame_dirty (struct frame *f) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      if (pagedir_is_dirty (p->owner->pagedir, p->upage))
+        return p;
+    }
+  return NULL;
+}
+
+/* Returns true if F's contents must be written to swap for it to
+   be evicted, because they were modified since they were read in
+   from a file or were zeroed.  Memory-mapped file pages are
+   written back to their file instead. */
+static bool
+needs_swap (struct frame *f) 
+{
+  struct page *p;
+
+  if (f->inode != NULL)
+    return false;
+  p = list_entry (list_front (&f->pages), struct page, frame_elem);
+  return p->type == PAGE_SWAP || frame_dirty (f) != NULL;
+}
+
+/* Removes the mappings of every page in F, or, if MAP, puts them
+   back, marked dirty. */
+static void
+map_all (struct frame *f, bool map) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      uint32_t *pd = p->owner->pagedir;
+
+      if (!map)
+        pagedir_clear_page (pd, p->upage);
+      else
+        {
+          /* Cannot fail: the page table entry is still there. */
+          pagedir_set_page (pd, p->upage, f->kpage, may_write (f, p));
+          pagedir_set_dirty (pd, p->upage, true);
+        }
+    }
+}
+
+/* Evicts up to EVICT_BATCH frames, chosen with the clock
+   algorithm, and returns one of them, pinned, for reuse.  The
+   others are freed, so that the next few frame_alloc() calls do
+   not have to evict.
+
+   The modified anonymous pages among them are written to a run
+   of consecutive swap slots with a single request, in clock
+   order, which is roughly the order their owners touched them
+   in.  page_load() reads such a run back in the same way.
+   Modified memory-mapped file pages are written back to their
+   files.
+
+   Returns a null pointer if every frame is pinned or would need
+   swap space that is not available.
+
+   frame_lock must be held.  It is released while pages are
+   written out. */
+static struct frame *
+evict (void) 
+{
+  struct frame *victims[EVICT_BATCH];
+  void *kpages[EVICT_BATCH];
+  struct page *writebacks[EVICT_BATCH];
+  size_t victim_cnt = 0, swap_cnt = 0, wb_cnt = 0;
+  size_t slot_cnt, slot;
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  slot_cnt = swap_alloc (EVICT_BATCH, &slot);
+
+  /* Two trips around the clock clear every accessed bit on the
+     first and so find victims on the second, if there are any
+     at all. */
+  for (i = 0; i < 2 * frame_cnt && victim_cnt < EVICT_BATCH; i++) 
+    {
+      struct frame *f = clock_next ();
+
+      if (f->pinned)
+        continue;
+      if (frame_accessed (f))
+        continue;               /* Second chance. */
+      if (swap_cnt == slot_cnt && needs_swap (f))
+        continue;
+
+      /* Unmap the pages before checking whether they are dirty
+         for good, so that their owners cannot dirty them
+         afterward. */
+      map_all (f, false);
+      if (needs_swap (f)) 
+        {
+          if (swap_cnt == slot_cnt) 
+            {
+              /* Dirtied just now, and no room to save it. */
+              map_all (f, true);
+              continue;
+            }
+
+          /* Keep swap victims first, in slot order. */
+          if (swap_cnt < victim_cnt)
+            victims[victim_cnt] = victims[swap_cnt];
+          victim_cnt++;
+          victims[swap_cnt] = f;
+          kpages[swap_cnt++] = f->kpage;
+        }
+      else 
+        {
+          struct page *dirty = f->inode != NULL ? frame_dirty (f) : NULL;
+
+          victims[victim_cnt++] = f;
+          if (dirty != NULL)
+            writebacks[wb_cnt++] = dirty;
+        }
+
+      /* Owners wait in wait_for_eviction() if they fault on the
+         page meanwhile. */
+      f->pinned = true;
+    }
+
+  if (swap_cnt < slot_cnt)
+    swap_free (slot + swap_cnt, slot_cnt - swap_cnt);
+  if (swap_cnt > 0 || wb_cnt > 0) 
+    {
+      /* The pinned frames' lists of pages cannot change until
+         we are done. */
+      lock_release (&frame_lock);
+      if (swap_cnt > 0)
+        swap_write (slot, kpages, swap_cnt);
+      for (i = 0; i < wb_cnt; i++) 
+        {
+          struct page *p = writebacks[i];
+          file_write_at (p->file, p->frame->kpage, p->read_bytes, p->ofs);
+        }
+      lock_acquire (&frame_lock);
+      swap_out_cnt += swap_cnt;
+      writeback_cnt += wb_cnt;
+    }
+
+  for (i = 0; i < victim_cnt; i++) 
+    {
+      struct frame *f = victims[i];
+
+      if (i < swap_cnt) 
+        {
+          struct list_elem *e;
+          size_t sharers = 0;
+
+          /* Pages shared after a fork share the slot too. */
+          for (e = list_begin (&f->pages); e != list_end (&f->pages);
+               e = list_next (e))
+            {
+              struct page *p = list_entry (e, struct page, frame_elem);
+              p->type = PAGE_SWAP;
+              p->swap_slot = slot + i;
+              sharers++;
+            }
+          if (sharers > 1)
+            swap_share (slot + i, sharers - 1);
+        }
+      detach_all (f);
+      f->pinned = false;
+      if (i > 0)
+        free_frame (f);
+    }
+  evict_cnt += victim_cnt;
+  if (victim_cnt > 0)
+    cond_broadcast (&frame_cond, &frame_lock);
+
+  return victim_cnt > 0 ? victims[0] : NULL;
+}
+
+/* Prints frame table statistics. */
+void
+frame_print_stats (void) 
+{
+  printf ("Frames: %zu in use, %lld evicted, %lld written to swap, "
+          "%lld written back to files, %lld faults shared\n",
+          frame_cnt, evict_cnt, swap_out_cnt, writeback_cnt, shared_cnt);
+  printf ("Copy-on-write: %lld frames shared by fork, %lld copied\n",
+          fork_share_cnt, cow_copy_cnt);
+  swap_print_stats ();
+}
+
+/* Returns a hash value for the page cache entry E. */
+static unsigned
+cache_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  const struct frame *f = hash_entry (e, struct frame, cache_elem);
+  return hash_bytes (&f->inode, sizeof f->inode) ^ hash_int (f->ofs);
+}
+
+/* Returns true if page cache entry A precedes B. */
+static bool
+cache_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED) 
+{
+  const struct frame *a = hash_entry (a_, struct frame, cache_elem);
+  const struct frame *b = hash_entry (b_, struct frame, cache_elem);
+
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  return a->ofs < b->ofs;
+}
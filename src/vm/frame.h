@@ -0,0 +1,49 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include "filesys/off_t.h"
+#include "threads/palloc.h"
+
+struct page;
+
+/* Frame table.
+
+   Every user pool page that holds a page of some process's
+   address space has a struct frame, recording the pages whose
+   contents it holds.  Usually that is a single page, but every
+   process that maps the same page of a file shares one frame,
+   found through the page cache, and a forked process shares its
+   parent's frames copy-on-write.  When the user pool runs out,
+   frame_alloc() takes frames away from their pages, choosing
+   them with the clock algorithm.
+
+   A frame is pinned while its contents are being read in or
+   written out, and pinned frames are never evicted. */
+struct frame
+  {
+    struct list_elem elem;      /* Element in the frame table. */
+    void *kpage;                /* Kernel virtual address. */
+    struct list pages;          /* Pages held, as struct page. */
+    bool pinned;                /* Being read or written? */
+
+    /* Memory-mapped file pages only. */
+    struct inode *inode;        /* File in the page cache, or null. */
+    off_t ofs;                  /* Offset in INODE. */
+    struct hash_elem cache_elem; /* Element in the page cache. */
+  };
+
+void frame_init (void);
+struct frame *frame_alloc (struct page *, enum palloc_flags);
+struct frame *frame_try_alloc (struct page *);
+struct frame *frame_alloc_shared (struct page *, bool *shared);
+bool frame_fork (struct page *parent, struct page *child);
+bool frame_unshare (struct page *);
+void frame_unpin (struct frame *);
+void frame_free (struct frame *);
+void frame_drop (struct page *);
+void frame_print_stats (void);
+
+#endif /* vm/frame.h */
@@ -0,0 +1,162 @@
+#include "vm/mmap.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/page.h"
+
+/* A mapping, in its process's list of mappings. */
+struct mapping
+  {
+    struct list_elem elem;      /* Element in thread's `mappings'. */
+    mapid_t id;                 /* Identifier. */
+    struct file *file;          /* Mapped file, our own handle. */
+    uint8_t *addr;              /* First page. */
+    size_t page_cnt;            /* Number of pages. */
+  };
+
+/* Creates a mapping of all of FILE, which must not be empty, at
+   ADDR, which must be page-aligned, in the current process's
+   address space.  Returns the new mapping, without an
+   identifier and not yet in the process's list, or a null
+   pointer if any page of it would overlap the kernel or some
+   other part of the address space or if memory is short. */
+static struct mapping *
+map (struct file *file, uint8_t *addr) 
+{
+  off_t length = file_length (file);
+  struct mapping *m;
+  size_t i;
+
+  ASSERT (length > 0);
+  ASSERT (pg_ofs (addr) == 0);
+
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return NULL;
+  m->file = file_reopen (file);
+  if (m->file == NULL) 
+    {
+      free (m);
+      return NULL;
+    }
+  m->addr = addr;
+  m->page_cnt = DIV_ROUND_UP (length, PGSIZE);
+
+  for (i = 0; i < m->page_cnt; i++) 
+    {
+      uint8_t *upage = addr + i * PGSIZE;
+      off_t ofs = i * PGSIZE;
+      size_t read_bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+
+      if (!is_user_vaddr (upage)
+          || !page_add_mmap (upage, m->file, ofs, read_bytes)) 
+        {
+          while (i-- > 0)
+            page_remove (addr + i * PGSIZE);
+          file_close (m->file);
+          free (m);
+          return NULL;
+        }
+    }
+  return m;
+}
+
+/* Maps FILE into the current process's address space starting
+   at ADDR, which must be page-aligned, and returns an identifier
+   for the mapping.  The mapping stays in place if FILE is
+   closed.  Returns MAP_FAILED if FILE is empty or any page of
+   the mapping would overlap the kernel or some other part of
+   the address space, or if memory is short. */
+mapid_t
+mmap_map (struct file *file, void *addr_) 
+{
+  struct thread *t = thread_current ();
+  uint8_t *addr = addr_;
+  struct mapping *m;
+
+  if (file == NULL || addr == NULL || pg_ofs (addr) != 0
+      || file_length (file) == 0)
+    return MAP_FAILED;
+
+  m = map (file, addr);
+  if (m == NULL)
+    return MAP_FAILED;
+  m->id = t->next_mapid++;
+  list_push_back (&t->mappings, &m->elem);
+  return m->id;
+}
+
+/* Gives the current process the same mappings, with the same
+   identifiers, as PARENT, the process it is being forked from.
+   The mapped pages are shared through the page cache, so that
+   each process sees the other's modifications, as after
+   mmap_map() of the same file in both.  Returns true if
+   successful, false if memory is short. */
+bool
+mmap_fork (struct thread *parent) 
+{
+  struct thread *t = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&parent->mappings); e != list_end (&parent->mappings);
+       e = list_next (e))
+    {
+      struct mapping *pm = list_entry (e, struct mapping, elem);
+      struct mapping *m = map (pm->file, pm->addr);
+
+      if (m == NULL)
+        return false;
+      m->id = pm->id;
+      list_push_back (&t->mappings, &m->elem);
+    }
+  t->next_mapid = parent->next_mapid;
+  return true;
+}
+
+/* Removes mapping M, writing back the pages that the current
+   process modified. */
+static void
+unmap (struct mapping *m) 
+{
+  size_t i;
+
+  for (i = 0; i < m->page_cnt; i++)
+    page_remove (m->addr + i * PGSIZE);
+  file_close (m->file);
+  list_remove (&m->elem);
+  free (m);
+}
+
+/* Removes the current process's mapping MAPPING, if there is
+   one. */
+void
+mmap_unmap (mapid_t mapping) 
+{
+  struct thread *t = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&t->mappings); e != list_end (&t->mappings);
+       e = list_next (e))
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      if (m->id == mapping) 
+        {
+          unmap (m);
+          return;
+        }
+    }
+}
+
+/* Removes all of the current process's mappings, as it exits. */
+void
+mmap_unmap_all (void) 
+{
+  struct thread *t = thread_current ();
+
+  while (!list_empty (&t->mappings))
+    unmap (list_entry (list_front (&t->mappings), struct mapping, elem));
+}
@@ -0,0 +1,27 @@
+#ifndef VM_MMAP_H
+#define VM_MMAP_H
+
+#include <stdbool.h>
+
+struct file;
+struct thread;
+
+/* Memory-mapped files.
+
+   mmap_map() maps a whole file into the current process's
+   address space, a page at a time through the supplemental page
+   table, so that nothing is read until it is touched and pages
+   are shared with other processes mapping the same file.
+   Modified pages are written back when they are evicted or
+   unmapped, and when the process exits. */
+
+/* Map region identifier. */
+typedef int mapid_t;
+#define MAP_FAILED ((mapid_t) -1)
+
+mapid_t mmap_map (struct file *, void *addr);
+void mmap_unmap (mapid_t);
+void mmap_unmap_all (void);
+bool mmap_fork (struct thread *parent);
+
+#endif /* vm/mmap.h */
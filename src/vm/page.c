@@ -0,0 +1,429 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+#include "vm/swap.h"
+
+/* Cache of struct page. */
+static struct kmem_cache *page_cache;
+
+/* Statistics. */
+static long long file_load_cnt;         /* PAGE_FILE pages brought in. */
+static long long zero_load_cnt;         /* PAGE_ZERO pages brought in. */
+static long long swap_load_cnt;         /* PAGE_SWAP pages brought in. */
+static long long swap_ahead_cnt;        /* ...and read ahead with them. */
+
+static hash_hash_func page_hash;
+static hash_less_func page_less;
+static hash_action_func page_destructor;
+
+/* Initializes the supplemental page table module. */
+void
+page_init (void) 
+{
+  page_cache = kmem_cache_create ("page", sizeof (struct page), 0, NULL);
+  if (page_cache == NULL)
+    PANIC ("page_init: out of memory");
+  frame_init ();
+  swap_init ();
+}
+
+/* Initializes PAGES as an empty supplemental page table.
+   Returns true if successful, false on allocation failure. */
+bool
+page_table_init (struct hash *pages) 
+{
+  return hash_init (pages, page_hash, page_less, NULL);
+}
+
+/* Frees every entry in PAGES, a table of the current process,
+   with its frame and swap slot, and then PAGES itself.  Must be
+   called before the process's page directory is destroyed.
+
+   A table that was never initialized, in a thread that never
+   ran a user program, is all zeros and is freed harmlessly. */
+void
+page_table_destroy (struct hash *pages) 
+{
+  hash_destroy (pages, page_destructor);
+}
+
+/* Adds an entry for UPAGE to the current process's supplemental
+   page table.  Returns the new entry, or a null pointer if
+   UPAGE already has one or memory is short. */
+static struct page *
+page_add (void *upage, enum page_type type, bool writable) 
+{
+  struct thread *t = thread_current ();
+  struct page *p;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  p = kmem_cache_alloc (page_cache);
+  if (p == NULL)
+    return NULL;
+  p->owner = t;
+  p->upage = upage;
+  p->type = type;
+  p->writable = writable;
+  p->file = NULL;
+  p->ofs = 0;
+  p->read_bytes = 0;
+  p->frame = NULL;
+  p->swap_slot = SWAP_ERROR;
+  if (hash_insert (&t->pages, &p->elem) != NULL) 
+    {
+      kmem_cache_free (page_cache, p);
+      return NULL;
+    }
+  return p;
+}
+
+/* Arranges for UPAGE to be loaded on first touch by reading
+   READ_BYTES bytes from FILE at offset OFS and zeroing the rest
+   of the page.  FILE must stay open for as long as the page
+   exists.  Returns true if successful, false if UPAGE is
+   already in use or memory is short. */
+bool
+page_add_file (void *upage, struct file *file, off_t ofs,
+               size_t read_bytes, bool writable) 
+{
+  struct page *p;
+
+  ASSERT (read_bytes <= PGSIZE);
+
+  p = page_add (upage, PAGE_FILE, writable);
+  if (p == NULL)
+    return false;
+  p->file = file;
+  p->ofs = ofs;
+  p->read_bytes = read_bytes;
+  return true;
+}
+
+/* Arranges for UPAGE to be a page of zeros on first touch.
+   Returns true if successful, false if UPAGE is already in use
+   or memory is short. */
+bool
+page_add_zero (void *upage, bool writable) 
+{
+  return page_add (upage, PAGE_ZERO, writable) != NULL;
+}
+
+/* Arranges for UPAGE to hold the READ_BYTES bytes of FILE at
+   offset OFS, followed by zeros, as part of a writable mapping
+   of FILE.  The page is shared with other processes that map
+   the same part of the file, and modifications to the first
+   READ_BYTES bytes are written back.  FILE must stay open for
+   as long as the page exists.  Returns true if successful,
+   false if UPAGE is already in use or memory is short. */
+bool
+page_add_mmap (void *upage, struct file *file, off_t ofs,
+               size_t read_bytes) 
+{
+  struct page *p;
+
+  ASSERT (read_bytes <= PGSIZE);
+  ASSERT (ofs % PGSIZE == 0);
+
+  p = page_add (upage, PAGE_MMAP, true);
+  if (p == NULL)
+    return false;
+  p->file = file;
+  p->ofs = ofs;
+  p->read_bytes = read_bytes;
+  return true;
+}
+
+/* Removes UPAGE from the current process's address space, if it
+   is there, writing it back to its file first if it is a
+   modified PAGE_MMAP page. */
+void
+page_remove (void *upage) 
+{
+  struct thread *t = thread_current ();
+  struct page *p = page_lookup (&t->pages, upage);
+
+  if (p != NULL) 
+    {
+      hash_delete (&t->pages, &p->elem);
+      page_destructor (&p->elem, NULL);
+    }
+}
+
+/* Returns the entry for the page containing UPAGE in PAGES, or a
+   null pointer if there is none. */
+struct page *
+page_lookup (struct hash *pages, const void *upage) 
+{
+  struct page p;
+  struct hash_elem *e;
+
+  p.upage = pg_round_down (upage);
+  e = hash_find (pages, &p.elem);
+  return e != NULL ? hash_entry (e, struct page, elem) : NULL;
+}
+
+/* Reads P, a PAGE_SWAP page of the current process, from swap
+   into its frame F.  The pages that follow P in the address
+   space are read along with it if they were swapped out to the
+   slots that follow P's, which is likely if they were evicted
+   together, and if there are free frames for them.  They are
+   mapped, but not marked accessed, so that they are among the
+   first to go again if they turn out not to be needed. */
+static void
+read_swap (struct page *p, struct frame *f) 
+{
+  struct thread *t = thread_current ();
+  struct page *pages[SWAP_CLUSTER];
+  struct frame *frames[SWAP_CLUSTER];
+  void *kpages[SWAP_CLUSTER];
+  size_t cnt, i;
+
+  pages[0] = p;
+  frames[0] = f;
+  kpages[0] = f->kpage;
+  for (cnt = 1; cnt < SWAP_CLUSTER; cnt++) 
+    {
+      uint8_t *upage = (uint8_t *) p->upage + cnt * PGSIZE;
+      struct page *next;
+      struct frame *next_f;
+
+      if (!is_user_vaddr (upage))
+        break;
+      next = page_lookup (&t->pages, upage);
+      if (next == NULL || next->type != PAGE_SWAP)
+        break;
+      next_f = frame_try_alloc (next);
+      if (next_f == NULL)
+        break;
+      /* Map it right away, as in page_load(). */
+      if (next->swap_slot != p->swap_slot + cnt
+          || !pagedir_set_page (t->pagedir, upage, next_f->kpage,
+                                next->writable))
+        {
+          frame_free (next_f);
+          break;
+        }
+      pages[cnt] = next;
+      frames[cnt] = next_f;
+      kpages[cnt] = next_f->kpage;
+    }
+
+  swap_read (p->swap_slot, kpages, cnt);
+  swap_free (p->swap_slot, cnt);
+  p->swap_slot = SWAP_ERROR;
+  swap_load_cnt++;
+
+  for (i = 1; i < cnt; i++) 
+    {
+      pages[i]->swap_slot = SWAP_ERROR;
+      frame_unpin (frames[i]);
+      swap_ahead_cnt++;
+    }
+}
+
+/* Brings in the page containing FAULT_ADDR, a user address that
+   the current process touched but that is not present in its
+   page directory.  Returns true if successful, false if
+   FAULT_ADDR is not part of the process's address space or no
+   frame is available. */
+bool
+page_load (void *fault_addr) 
+{
+  struct thread *t = thread_current ();
+  struct page *p;
+  struct frame *f;
+  uint8_t *kpage;
+
+  if (!is_user_vaddr (fault_addr))
+    return false;
+  p = page_lookup (&t->pages, fault_addr);
+  if (p == NULL || pagedir_get_page (t->pagedir, p->upage) != NULL)
+    return false;
+
+  /* If P is being evicted, these wait for that to finish, after
+     which P's type and swap slot are stable. */
+  if (p->type == PAGE_MMAP) 
+    {
+      bool shared;
+
+      f = frame_alloc_shared (p, &shared);
+      if (f == NULL)
+        return false;
+      if (shared)
+        return true;
+    }
+  else
+    f = frame_alloc (p, p->type == PAGE_ZERO ? PAL_ZERO : 0);
+  if (f == NULL)
+    return false;
+  kpage = f->kpage;
+
+  /* Map the frame before filling it, so that running out of
+     page table memory cannot lose what was in swap.  Only this
+     thread, which is busy here, can touch the page before it is
+     filled. */
+  if (!pagedir_set_page (t->pagedir, p->upage, kpage, p->writable)) 
+    {
+      frame_free (f);
+      return false;
+    }
+
+  switch (p->type) 
+    {
+    case PAGE_FILE:
+    case PAGE_MMAP:
+      if (file_read_at (p->file, kpage, p->read_bytes, p->ofs)
+          != (off_t) p->read_bytes)
+        {
+          pagedir_clear_page (t->pagedir, p->upage);
+          frame_free (f);
+          return false;
+        }
+      memset (kpage + p->read_bytes, 0, PGSIZE - p->read_bytes);
+      file_load_cnt++;
+      break;
+
+    case PAGE_ZERO:
+      /* Most likely one of the idle thread's pre-zeroed pages. */
+      zero_load_cnt++;
+      break;
+
+    case PAGE_SWAP:
+      read_swap (p, f);
+      break;
+
+    default:
+      NOT_REACHED ();
+    }
+
+  frame_unpin (f);
+  return true;
+}
+
+/* Copies the supplemental page table of PARENT, the process that
+   the current one is being forked from, into the current
+   process's, sharing the pages' contents as described for
+   frame_fork().  Memory-mapped file pages are left to
+   mmap_fork().  PARENT must not run meanwhile.  Returns true if
+   successful, false if memory is short. */
+bool
+page_fork (struct thread *parent) 
+{
+  struct thread *t = thread_current ();
+  struct hash_iterator i;
+
+  hash_first (&i, &parent->pages);
+  while (hash_next (&i)) 
+    {
+      struct page *pp = hash_entry (hash_cur (&i), struct page, elem);
+      struct page *p;
+
+      if (pp->type == PAGE_MMAP)
+        continue;
+      p = page_add (pp->upage, pp->type, pp->writable);
+      if (p == NULL)
+        return false;
+      if (pp->file != NULL) 
+        {
+          /* Apart from mappings, pages come only from the
+             executable, which each process has open. */
+          ASSERT (pp->file == parent->exec_file);
+          p->file = t->exec_file;
+          p->ofs = pp->ofs;
+          p->read_bytes = pp->read_bytes;
+        }
+      if (!frame_fork (pp, p))
+        return false;
+    }
+  return true;
+}
+
+/* Handles a write by the current process to the page containing
+   FAULT_ADDR, which is present but mapped read-only.  Returns
+   true if the page is writable but was shared by a fork, and
+   now is not, so that the write may be retried.  Returns false
+   if the write is not allowed or no frame is available. */
+bool
+page_unshare (void *fault_addr) 
+{
+  struct thread *t = thread_current ();
+  struct page *p;
+
+  if (!is_user_vaddr (fault_addr))
+    return false;
+  p = page_lookup (&t->pages, fault_addr);
+  if (p == NULL || !p->writable || p->type == PAGE_MMAP)
+    return false;
+  return frame_unshare (p);
+}
+
+/* Extends the current process's stack down to the page that
+   contains ADDR, given that its user stack pointer is ESP.
+   Only an access no more than 32 bytes below ESP, as PUSHA
+   makes, and within STACK_MAX of the top of user memory counts
+   as a stack access.  Returns true if a page was added for
+   ADDR, which page_load() then brings in. */
+bool
+page_grow_stack (const void *addr, const void *esp) 
+{
+  const uint8_t *a = addr;
+
+  if (thread_current ()->pagedir == NULL || esp == NULL
+      || !is_user_vaddr (addr)
+      || a < (const uint8_t *) PHYS_BASE - STACK_MAX
+      || a + 32 < (const uint8_t *) esp)
+    return false;
+  return page_add_zero (pg_round_down (addr), true);
+}
+
+/* Prints demand paging statistics. */
+void
+page_print_stats (void) 
+{
+  printf ("Demand paging: %lld file pages, %lld zero pages, "
+          "%lld swap pages loaded, %lld more read ahead\n",
+          file_load_cnt, zero_load_cnt, swap_load_cnt, swap_ahead_cnt);
+  frame_print_stats ();
+}
+
+/* Returns a hash value for the page that E refers to. */
+static unsigned
+page_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  const struct page *p = hash_entry (e, struct page, elem);
+  return hash_bytes (&p->upage, sizeof p->upage);
+}
+
+/* Returns true if page A precedes page B. */
+static bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED) 
+{
+  const struct page *a = hash_entry (a_, struct page, elem);
+  const struct page *b = hash_entry (b_, struct page, elem);
+
+  return a->upage < b->upage;
+}
+
+/* Frees the page that E refers to, with its frame and swap
+   slot. */
+static void
+page_destructor (struct hash_elem *e, void *aux UNUSED) 
+{
+  struct page *p = hash_entry (e, struct page, elem);
+
+  frame_drop (p);
+  if (p->swap_slot != SWAP_ERROR)
+    swap_free (p->swap_slot, 1);
+  kmem_cache_free (page_cache, p);
+}
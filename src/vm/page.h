@@ -0,0 +1,81 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+
+struct thread;
+
+/* Supplemental page table.
+
+   Each process has a hash table of the pages in its address
+   space that are not necessarily present in its page directory,
+   recording where each page's contents come from.  A page is
+   brought in by page_load() the first time it is touched, so
+   that a process pays for reading and zeroing only the pages it
+   actually uses.
+
+   A page that is evicted after being modified becomes a
+   PAGE_SWAP page and is brought back in from swap.
+
+   PAGE_MMAP pages belong to a memory-mapped file.  All the
+   processes that map the same page of a file share one frame,
+   and modifications are written back to the file.
+
+   A forked process starts out sharing its parent's other pages,
+   read-only, and page_unshare() copies a page when either
+   process first writes to it. */
+
+/* Maximum size of a process's stack, which grows down from
+   PHYS_BASE one page at a time as the process touches it. */
+#define STACK_MAX (8 * 1024 * 1024)
+
+/* Where a page's contents come from. */
+enum page_type
+  {
+    PAGE_FILE,                  /* Read from a file, rest zeroed. */
+    PAGE_ZERO,                  /* All zeros. */
+    PAGE_SWAP,                  /* Modified: in swap when evicted. */
+    PAGE_MMAP                   /* Memory-mapped file, shared. */
+  };
+
+/* A page in a process's address space. */
+struct page
+  {
+    struct hash_elem elem;      /* Element in the supplemental page table. */
+    struct thread *owner;       /* Process whose page this is. */
+    void *upage;                /* User virtual address. */
+    enum page_type type;        /* Source of contents. */
+    bool writable;              /* Writable by the process? */
+    struct frame *frame;        /* Frame holding the page, or null. */
+    struct list_elem frame_elem; /* Element in frame's list of pages. */
+    size_t swap_slot;           /* PAGE_SWAP, when evicted: swap slot. */
+
+    /* PAGE_FILE and PAGE_MMAP only. */
+    struct file *file;          /* File to read from. */
+    off_t ofs;                  /* Offset in FILE. */
+    size_t read_bytes;          /* Bytes to read; the rest are zeroed. */
+  };
+
+void page_init (void);
+bool page_table_init (struct hash *);
+void page_table_destroy (struct hash *);
+
+bool page_add_file (void *upage, struct file *, off_t ofs,
+                    size_t read_bytes, bool writable);
+bool page_add_zero (void *upage, bool writable);
+bool page_add_mmap (void *upage, struct file *, off_t ofs,
+                    size_t read_bytes);
+void page_remove (void *upage);
+struct page *page_lookup (struct hash *, const void *upage);
+bool page_load (void *fault_addr);
+bool page_fork (struct thread *parent);
+bool page_unshare (void *fault_addr);
+bool page_grow_stack (const void *addr, const void *esp);
+
+void page_print_stats (void);
+
+#endif /* vm/page.h */
@@ -0,0 +1,192 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Number of sectors in a swap slot. */
+#define SECTORS_PER_SLOT (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Swap device, or a null pointer if there is none. */
+static struct block *swap_device;
+
+/* Bitmap of slots in use, the number of pages beyond the first
+   that refer to each slot in use, and a lock that protects
+   them. */
+static struct bitmap *swap_map;
+static uint16_t *slot_sharers;
+static struct lock swap_lock;
+
+/* Contiguous buffer for transferring a run of pages that are
+   scattered in memory with one request, and a lock that
+   protects it and the statistics below. */
+static uint8_t *cluster_buf;
+static struct lock io_lock;
+
+/* Statistics. */
+static long long out_pages, out_requests;
+static long long in_pages, in_requests;
+static uint64_t out_ns, in_ns;
+
+/* Initializes swap, on the BLOCK_SWAP device if there is one.
+   Without one, swap is always full. */
+void
+swap_init (void) 
+{
+  size_t slot_cnt = 0;
+
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device != NULL) 
+    {
+      slot_cnt = block_size (swap_device) / SECTORS_PER_SLOT;
+      cluster_buf = palloc_get_multiple (PAL_ASSERT, SWAP_CLUSTER);
+    }
+  else
+    printf ("swap: no swap device, evicting clean pages only\n");
+
+  swap_map = bitmap_create (slot_cnt);
+  /* One extra, because malloc() returns a null pointer for an
+     empty block. */
+  slot_sharers = calloc (slot_cnt + 1, sizeof *slot_sharers);
+  if (swap_map == NULL || slot_sharers == NULL)
+    PANIC ("swap_init: out of memory");
+  lock_init (&swap_lock);
+  lock_set_name (&swap_lock, "swap");
+  lock_init (&io_lock);
+  lock_set_name (&io_lock, "swap io");
+}
+
+/* Allocates a run of up to MAX_CNT consecutive swap slots,
+   preferring longer runs, and stores the first in *SLOT.
+   Returns the number of slots allocated, 0 if swap is full. */
+size_t
+swap_alloc (size_t max_cnt, size_t *slot) 
+{
+  size_t cnt;
+
+  ASSERT (max_cnt <= SWAP_CLUSTER);
+
+  lock_acquire (&swap_lock);
+  for (cnt = max_cnt; cnt > 0; cnt /= 2) 
+    {
+      *slot = bitmap_scan_and_flip (swap_map, 0, cnt, false);
+      if (*slot != BITMAP_ERROR)
+        break;
+    }
+  lock_release (&swap_lock);
+
+  if (cnt == 0)
+    *slot = SWAP_ERROR;
+  return cnt;
+}
+
+/* Lets go of the CNT slots starting at SLOT, which must be in
+   use, freeing those that no other page refers to. */
+void
+swap_free (size_t slot, size_t cnt) 
+{
+  size_t i;
+
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_all (swap_map, slot, cnt));
+  for (i = slot; i < slot + cnt; i++)
+    if (slot_sharers[i] > 0)
+      slot_sharers[i]--;
+    else
+      bitmap_reset (swap_map, i);
+  lock_release (&swap_lock);
+}
+
+/* Records that CNT more pages refer to SLOT, which must be in
+   use, so that it takes CNT more calls to swap_free() to free
+   it. */
+void
+swap_share (size_t slot, size_t cnt) 
+{
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (swap_map, slot));
+  ASSERT (slot_sharers[slot] + cnt <= UINT16_MAX);
+  slot_sharers[slot] += cnt;
+  lock_release (&swap_lock);
+}
+
+/* Writes the CNT pages KPAGES[] to the slots starting at SLOT,
+   with a single request. */
+void
+swap_write (size_t slot, void *const kpages[], size_t cnt) 
+{
+  uint64_t start;
+  size_t i;
+
+  ASSERT (cnt > 0 && cnt <= SWAP_CLUSTER);
+  ASSERT (slot + cnt <= bitmap_size (swap_map));
+
+  lock_acquire (&io_lock);
+  start = timer_now_ns ();
+  if (cnt == 1)
+    block_write_multiple (swap_device, slot * SECTORS_PER_SLOT,
+                          SECTORS_PER_SLOT, kpages[0]);
+  else
+    {
+      for (i = 0; i < cnt; i++)
+        memcpy (cluster_buf + i * PGSIZE, kpages[i], PGSIZE);
+      block_write_multiple (swap_device, slot * SECTORS_PER_SLOT,
+                            cnt * SECTORS_PER_SLOT, cluster_buf);
+    }
+  out_ns += timer_now_ns () - start;
+  out_pages += cnt;
+  out_requests++;
+  lock_release (&io_lock);
+}
+
+/* Reads the CNT slots starting at SLOT into the pages KPAGES[],
+   with a single request. */
+void
+swap_read (size_t slot, void *const kpages[], size_t cnt) 
+{
+  uint64_t start;
+  size_t i;
+
+  ASSERT (cnt > 0 && cnt <= SWAP_CLUSTER);
+  ASSERT (slot + cnt <= bitmap_size (swap_map));
+
+  lock_acquire (&io_lock);
+  start = timer_now_ns ();
+  if (cnt == 1)
+    block_read_multiple (swap_device, slot * SECTORS_PER_SLOT,
+                         SECTORS_PER_SLOT, kpages[0]);
+  else
+    {
+      block_read_multiple (swap_device, slot * SECTORS_PER_SLOT,
+                           cnt * SECTORS_PER_SLOT, cluster_buf);
+      for (i = 0; i < cnt; i++)
+        memcpy (kpages[i], cluster_buf + i * PGSIZE, PGSIZE);
+    }
+  in_ns += timer_now_ns () - start;
+  in_pages += cnt;
+  in_requests++;
+  lock_release (&io_lock);
+}
+
+/* Returns PAGES per NS nanoseconds as pages per second. */
+static long long
+pages_per_sec (long long pages, uint64_t ns) 
+{
+  return ns > 0 ? pages * 1000000000LL / (long long) ns : 0;
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void) 
+{
+  printf ("Swap: %lld pages out in %lld requests (%lld pages/s), "
+          "%lld pages in in %lld requests (%lld pages/s)\n",
+          out_pages, out_requests, pages_per_sec (out_pages, out_ns),
+          in_pages, in_requests, pages_per_sec (in_pages, in_ns));
+}
@@ -0,0 +1,34 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Swap slots.
+
+   The swap device is divided into page-size slots, tracked by a
+   bitmap.  Slots are allocated before anything is written to
+   them, so that an evictor can tell whether there is room
+   before it commits to evicting anything, and in runs, so that
+   pages evicted together can be written, and later read back,
+   with one multi-sector request.
+
+   After a fork, the parent's and the child's copies of a page
+   may share a slot, which is freed once both have let go of
+   it. */
+
+/* Most pages in one swap request. */
+#define SWAP_CLUSTER 8
+
+/* Not a swap slot. */
+#define SWAP_ERROR SIZE_MAX
+
+void swap_init (void);
+size_t swap_alloc (size_t max_cnt, size_t *slot);
+void swap_free (size_t slot, size_t cnt);
+void swap_share (size_t slot, size_t cnt);
+void swap_write (size_t slot, void *const kpages[], size_t cnt);
+void swap_read (size_t slot, void *const kpages[], size_t cnt);
+void swap_print_stats (void);
+
+#endif /* vm/swap.h */